@@ -0,0 +1,266 @@
+/* See LICENSE file for copyright and license details. */
+#include <xcb/xcbext.h>
+#include "main.h"
+#include "backend.h"
+#include "stats.h"
+#include "trace.h"
+#include "watchdog.h"
+#include "log.h"
+
+void backend_create_window(xcb_window_t win, xcb_window_t parent,
+                           const xcb_rectangle_t *r, uint16_t border,
+                           uint16_t class, uint32_t mask,
+                           const uint32_t *values) {
+    xcb_create_window(conn, XCB_COPY_FROM_PARENT, win, parent, r->x, r->y,
+                      r->width, r->height, border, class,
+                      XCB_COPY_FROM_PARENT, mask, values);
+}
+
+void backend_destroy(xcb_window_t win) {
+    xcb_destroy_window(conn, win);
+}
+
+void backend_set_attributes(xcb_window_t win, uint32_t mask,
+                            const uint32_t *values) {
+    xcb_change_window_attributes(conn, win, mask, values);
+}
+
+void backend_configure(xcb_window_t win, uint16_t mask,
+                       const uint32_t *values) {
+    xcb_configure_window(conn, win, mask, values);
+}
+
+void backend_map(xcb_window_t win) {
+    xcb_map_window(conn, win);
+}
+
+void backend_unmap(xcb_window_t win) {
+    xcb_unmap_window(conn, win);
+}
+
+void backend_reparent(xcb_window_t win, xcb_window_t parent, int16_t x,
+                      int16_t y) {
+    xcb_reparent_window(conn, win, parent, x, y);
+}
+
+void backend_set_property(xcb_window_t win, uint8_t mode, xcb_atom_t prop,
+                          xcb_atom_t type, uint8_t format, uint32_t len,
+                          const void *data) {
+    xcb_change_property(conn, mode, win, prop, type, format, len, data);
+}
+
+void backend_delete_property(xcb_window_t win, xcb_atom_t prop) {
+    xcb_delete_property(conn, win, prop);
+}
+
+/* ev is a 32-byte core event */
+void backend_send_event(xcb_window_t win, uint32_t mask, const void *ev) {
+    xcb_send_event(conn, false, win, mask, ev);
+}
+
+void backend_kill(xcb_window_t win) {
+    xcb_kill_client(conn, win);
+}
+
+void backend_allow_events(uint8_t mode, xcb_timestamp_t time) {
+    xcb_allow_events(conn, mode, time);
+}
+
+/* passive grabs held, for the resource report */
+static unsigned int key_grabs, button_grabs;
+
+/* key and button grabs are all on the root window */
+void backend_grab_key(uint16_t mod, xcb_keycode_t key) {
+    key_grabs++;
+    xcb_grab_key(conn, 1, screen->root, mod, key, XCB_GRAB_MODE_ASYNC,
+                 XCB_GRAB_MODE_ASYNC);
+}
+
+void backend_ungrab_keys(void) {
+    key_grabs = 0;
+    xcb_ungrab_key(conn, XCB_GRAB_ANY, screen->root, XCB_MOD_MASK_ANY);
+}
+
+/* synchronous, so a click can be replayed to the client underneath */
+void backend_grab_button(uint16_t mod, uint8_t button) {
+    button_grabs++;
+    xcb_grab_button(conn, 0, screen->root, XCB_EVENT_MASK_BUTTON_PRESS,
+                    XCB_GRAB_MODE_SYNC, XCB_GRAB_MODE_ASYNC, XCB_WINDOW_NONE,
+                    XCB_CURSOR_NONE, button, mod);
+}
+
+void backend_ungrab_buttons(void) {
+    button_grabs = 0;
+    xcb_ungrab_button(conn, XCB_BUTTON_INDEX_ANY, screen->root,
+                      XCB_MOD_MASK_ANY);
+}
+
+/* the one grab that needs an answer, so it costs a round trip */
+bool backend_grab_pointer(uint16_t mask, xcb_cursor_t cursor) {
+    xcb_grab_pointer_cookie_t cookie = xcb_grab_pointer(
+        conn, 0, screen->root, mask, XCB_GRAB_MODE_ASYNC, XCB_GRAB_MODE_ASYNC,
+        XCB_NONE, cursor, XCB_CURRENT_TIME);
+    xcb_grab_pointer_reply_t *r;
+    bool grabbed;
+
+    trace_ask(XCB_GRAB_POINTER, cookie.sequence, XCB_NONE, XCB_NONE);
+    if (!(r = backend_reply(cookie.sequence)))
+        return false;
+    grabbed = r->status == XCB_GRAB_STATUS_SUCCESS;
+    FREE(r);
+    return grabbed;
+}
+
+void backend_ungrab_pointer(void) {
+    xcb_ungrab_pointer(conn, XCB_CURRENT_TIME);
+}
+
+/* XCB_NONE gives the focus back to whatever is under the pointer */
+void backend_focus(xcb_window_t win) {
+    if (win == XCB_NONE)
+        xcb_set_input_focus(conn, XCB_NONE, XCB_INPUT_FOCUS_POINTER_ROOT,
+                            XCB_CURRENT_TIME);
+    else
+        xcb_set_input_focus(conn, XCB_INPUT_FOCUS_POINTER_ROOT, win,
+                            XCB_CURRENT_TIME);
+}
+
+void backend_grabs(unsigned int *keys, unsigned int *buttons) {
+    *keys = key_grabs;
+    *buttons = button_grabs;
+}
+
+void backend_warp(xcb_window_t win, int16_t x, int16_t y) {
+    xcb_warp_pointer(conn, XCB_NONE, win, 0, 0, 0, 0, x, y);
+}
+
+xcb_window_t backend_new_id(void) {
+    const xcb_window_t id = xcb_generate_id(conn);
+
+    trace_answer(CAPTURE_NEW_ID, 0, XCB_NONE, &id, sizeof(id));
+    return id;
+}
+
+unsigned int backend_noop(void) {
+    return xcb_no_operation(conn).sequence;
+}
+
+void backend_flush(void) {
+    xcb_flush(conn);
+}
+
+/* waiting on the user isn't a stall */
+xcb_generic_event_t *backend_wait_event(void) {
+    xcb_generic_event_t *ev;
+
+    watchdog_idle();
+    ev = xcb_wait_for_event(conn);
+    watchdog_busy();
+    trace_answer(CAPTURE_WAIT, 0, XCB_NONE, ev, ev ? CAPTURE_EVENT_SIZE : 0);
+    return ev;
+}
+
+/* a capture has each read with what it asked for, which is how a replay
+ * finds the answer when the order of the reads differs */
+unsigned int backend_get_property(xcb_window_t win, xcb_atom_t prop,
+                                  xcb_atom_t type, uint32_t len) {
+    const unsigned int seq =
+        xcb_get_property(conn, 0, win, prop, type, 0, len).sequence;
+
+    trace_ask(XCB_GET_PROPERTY, seq, win, prop);
+    return seq;
+}
+
+unsigned int backend_get_geometry(xcb_window_t win) {
+    const unsigned int seq = xcb_get_geometry(conn, win).sequence;
+
+    trace_ask(XCB_GET_GEOMETRY, seq, win, XCB_NONE);
+    return seq;
+}
+
+unsigned int backend_query_pointer(void) {
+    const unsigned int seq = xcb_query_pointer(conn, screen->root).sequence;
+
+    trace_ask(XCB_QUERY_POINTER, seq, XCB_NONE, XCB_NONE);
+    return seq;
+}
+
+unsigned int backend_get_modifier_mapping(void) {
+    const unsigned int seq = xcb_get_modifier_mapping(conn).sequence;
+
+    trace_ask(XCB_GET_MODIFIER_MAPPING, seq, XCB_NONE, XCB_NONE);
+    return seq;
+}
+
+/* replies are 32 bytes and then length words */
+static void answered(unsigned int seq, const void *reply) {
+    const xcb_generic_reply_t *r = reply;
+
+    trace_answer(0, seq, XCB_NONE, r, r ? 32 + r->length * 4 : 0);
+}
+
+/* every reply waited for is a round trip, unless a later one has been
+ * waited for already */
+void *backend_reply(unsigned int seq) {
+    xcb_generic_error_t *e = NULL;
+    void *r;
+
+    stats_wait(seq);
+    r = xcb_wait_for_reply(conn, seq, &e);
+    free(e);
+    answered(seq, r);
+    return r;
+}
+
+bool backend_poll(unsigned int seq, void **reply) {
+    xcb_generic_error_t *e = NULL;
+
+    *reply = NULL;
+    if (!xcb_poll_for_reply(conn, seq, reply, &e))
+        return false;
+    free(e);
+    answered(seq, *reply);
+    return true;
+}
+
+void backend_discard(unsigned int seq) {
+    xcb_discard_reply(conn, seq);
+}
+
+static xcb_key_symbols_t *keysyms;
+
+static xcb_key_symbols_t *getkeysyms(void) {
+    if (!keysyms && !(keysyms = xcb_key_symbols_alloc(conn)))
+        err("can't get key symbols.");
+    return keysyms;
+}
+
+xcb_keycode_t *backend_keycodes(xcb_keysym_t sym) {
+    xcb_keycode_t *codes = xcb_key_symbols_get_keycode(getkeysyms(), sym);
+    uint32_t n = 0;
+
+    if (codes)
+        while (codes[n++] != XCB_NO_SYMBOL)
+            ;
+    trace_answer(CAPTURE_KEYCODES, 0, sym, codes, n);
+    return codes;
+}
+
+xcb_keysym_t backend_keysym(xcb_keycode_t code) {
+    const xcb_keysym_t sym =
+        xcb_key_symbols_get_keysym(getkeysyms(), code, 0);
+
+    trace_answer(CAPTURE_KEYSYM, 0, code, &sym, sizeof(sym));
+    return sym;
+}
+
+void backend_refresh_keymap(xcb_mapping_notify_event_t *e) {
+    if (keysyms)
+        xcb_refresh_keyboard_mapping(keysyms, e);
+}
+
+void backend_free_keymap(void) {
+    if (keysyms)
+        xcb_key_symbols_free(keysyms);
+    keysyms = NULL;
+}
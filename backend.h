@@ -0,0 +1,67 @@
+/* See LICENSE file for copyright and license details. */
+#ifndef BACKEND_H
+#define BACKEND_H
+
+#include <stdbool.h>
+#include <xcb/xcb.h>
+
+/* what tfwm asks of and tells the server once it runs goes through here:
+ * window creation, attributes, configure, map, reparent, properties,
+ * synthetic events, grabs, focus and warp, the reads handlers make, the
+ * keyboard map and the events a drag waits for. backend.c does it on
+ * conn; bench/model.c keeps an in-memory server instead. setup, which
+ * claims the root, interns atoms and loads cursors, talks to xcb. */
+void backend_create_window(xcb_window_t win, xcb_window_t parent,
+                           const xcb_rectangle_t *r, uint16_t border,
+                           uint16_t class, uint32_t mask,
+                           const uint32_t *values);
+void backend_destroy(xcb_window_t win);
+void backend_set_attributes(xcb_window_t win, uint32_t mask,
+                            const uint32_t *values);
+void backend_configure(xcb_window_t win, uint16_t mask,
+                       const uint32_t *values);
+void backend_map(xcb_window_t win);
+void backend_unmap(xcb_window_t win);
+void backend_reparent(xcb_window_t win, xcb_window_t parent, int16_t x,
+                      int16_t y);
+void backend_set_property(xcb_window_t win, uint8_t mode, xcb_atom_t prop,
+                          xcb_atom_t type, uint8_t format, uint32_t len,
+                          const void *data);
+void backend_delete_property(xcb_window_t win, xcb_atom_t prop);
+void backend_send_event(xcb_window_t win, uint32_t mask, const void *ev);
+void backend_kill(xcb_window_t win);
+void backend_allow_events(uint8_t mode, xcb_timestamp_t time);
+void backend_grab_key(uint16_t mod, xcb_keycode_t key);
+void backend_ungrab_keys(void);
+void backend_grab_button(uint16_t mod, uint8_t button);
+void backend_ungrab_buttons(void);
+bool backend_grab_pointer(uint16_t mask, xcb_cursor_t cursor);
+void backend_ungrab_pointer(void);
+void backend_grabs(unsigned int *keys, unsigned int *buttons);
+void backend_focus(xcb_window_t win);
+void backend_warp(xcb_window_t win, int16_t x, int16_t y);
+xcb_window_t backend_new_id(void);
+unsigned int backend_noop(void);
+void backend_flush(void);
+xcb_generic_event_t *backend_wait_event(void);
+
+/* reads are sent and answered apart, as in xcb: each request returns
+ * its sequence number, and the reply, an xcb reply struct for the caller
+ * to free, is waited for with backend_reply(), taken if it has come with
+ * backend_poll(), or dropped with backend_discard(). NULL on an error. */
+unsigned int backend_get_property(xcb_window_t win, xcb_atom_t prop,
+                                  xcb_atom_t type, uint32_t len);
+unsigned int backend_get_geometry(xcb_window_t win);
+unsigned int backend_query_pointer(void);
+unsigned int backend_get_modifier_mapping(void);
+void *backend_reply(unsigned int seq);
+bool backend_poll(unsigned int seq, void **reply);
+void backend_discard(unsigned int seq);
+
+/* the keyboard map, fetched once and then kept up by MappingNotify */
+xcb_keycode_t *backend_keycodes(xcb_keysym_t sym);
+xcb_keysym_t backend_keysym(xcb_keycode_t code);
+void backend_refresh_keymap(xcb_mapping_notify_event_t *e);
+void backend_free_keymap(void);
+
+#endif
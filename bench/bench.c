@@ -0,0 +1,651 @@
+/* See LICENSE file for copyright and license details. */
+/* drive a running tfwm from outside, as a client and through XTest, and
+ * time what it does. bench/run.sh starts one on a private Xvfb. */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <xcb/xcb.h>
+#include <xcb/xtest.h>
+#include <xcb/xcb_keysyms.h>
+#include <X11/keysym.h>
+
+#define LENGTH(X) (int)(sizeof(X) / sizeof(X)[0])
+/* modifiers held for a binding */
+enum { MOD = 1 << 0, SHIFT = 1 << 1 };
+static const xcb_keysym_t modkeys[] = {
+    XK_Super_L, /* what keys.c binds as MOD */
+    XK_Shift_L,
+};
+
+static xcb_connection_t *conn;
+static xcb_screen_t *screen;
+static xcb_key_symbols_t *keysyms;
+/* where report() also writes a json line per figure, if BENCH_JSON is
+ * set, and what for */
+static FILE *json;
+static const char *bench_name;
+static int bench_n;
+
+static uint64_t now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static xcb_keycode_t keycode(xcb_keysym_t sym) {
+    xcb_keycode_t *codes = xcb_key_symbols_get_keycode(keysyms, sym);
+    xcb_keycode_t code = codes ? codes[0] : 0;
+
+    free(codes);
+    if (!code) {
+        fprintf(stderr, "bench: no keycode for keysym %#x\n", sym);
+        exit(EXIT_FAILURE);
+    }
+    return code;
+}
+
+static void fake_key(uint8_t type, xcb_keysym_t sym) {
+    xcb_test_fake_input(conn, type, keycode(sym), XCB_CURRENT_TIME, XCB_NONE,
+                        0, 0, 0);
+}
+
+/* type a binding, with the modifiers in mods held */
+static void press(unsigned int mods, xcb_keysym_t sym) {
+    for (int i = 0; i < LENGTH(modkeys); i++)
+        if (mods & (1u << i))
+            fake_key(XCB_KEY_PRESS, modkeys[i]);
+    fake_key(XCB_KEY_PRESS, sym);
+    fake_key(XCB_KEY_RELEASE, sym);
+    for (int i = LENGTH(modkeys) - 1; i >= 0; i--)
+        if (mods & (1u << i))
+            fake_key(XCB_KEY_RELEASE, modkeys[i]);
+}
+
+/* the window an event is about */
+static xcb_window_t event_window(const xcb_generic_event_t *ev) {
+    switch (ev->response_type & ~0x80) {
+    case XCB_FOCUS_IN:
+        return ((const xcb_focus_in_event_t *)ev)->event;
+    case XCB_PROPERTY_NOTIFY:
+        return ((const xcb_property_notify_event_t *)ev)->window;
+    default:
+        /* the window field is at the same offset in the notifies */
+        return ((const xcb_map_notify_event_t *)ev)->window;
+    }
+}
+
+/* the next event of type on any of n windows, dropping the rest */
+static void wait_any(uint8_t type, const xcb_window_t *wins, int n) {
+    xcb_generic_event_t *ev;
+
+    xcb_flush(conn);
+    while ((ev = xcb_wait_for_event(conn))) {
+        const uint8_t t = ev->response_type & ~0x80;
+        const xcb_window_t w = event_window(ev);
+        free(ev);
+        for (int i = 0; t == type && i < n; i++)
+            if (w == wins[i])
+                return;
+    }
+    fprintf(stderr, "bench: lost the connection\n");
+    exit(EXIT_FAILURE);
+}
+
+static void wait_for(uint8_t type, xcb_window_t win) {
+    wait_any(type, &win, 1);
+}
+
+static xcb_window_t create(int16_t x, int16_t y, uint16_t w, uint16_t h) {
+    const xcb_window_t win = xcb_generate_id(conn);
+    const uint32_t mask = XCB_EVENT_MASK_STRUCTURE_NOTIFY;
+
+    xcb_create_window(conn, XCB_COPY_FROM_PARENT, win, screen->root, x, y, w,
+                      h, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                      screen->root_visual, XCB_CW_EVENT_MASK, &mask);
+    return win;
+}
+
+/* map a window and wait until it is framed: everything sent to the window
+ * manager before it has been handled by then */
+static xcb_window_t map(int16_t x, int16_t y, uint16_t w, uint16_t h) {
+    const xcb_window_t win = create(x, y, w, h);
+
+    xcb_map_window(conn, win);
+    wait_for(XCB_REPARENT_NOTIFY, win);
+    return win;
+}
+
+static void fence(void) {
+    xcb_destroy_window(conn, map(0, 0, 1, 1));
+}
+
+/* drop whatever events are queued */
+static void drain(void) {
+    xcb_generic_event_t *ev;
+
+    xcb_flush(conn);
+    while ((ev = xcb_poll_for_event(conn)))
+        free(ev);
+}
+
+/* the frame win was put in, watched for its moves */
+static xcb_window_t frame_of(xcb_window_t win) {
+    const uint32_t mask = XCB_EVENT_MASK_STRUCTURE_NOTIFY;
+    xcb_query_tree_reply_t *r =
+        xcb_query_tree_reply(conn, xcb_query_tree(conn, win), NULL);
+    const xcb_window_t frame = r ? r->parent : XCB_NONE;
+
+    free(r);
+    xcb_change_window_attributes(conn, frame, XCB_CW_EVENT_MASK, &mask);
+    return frame;
+}
+
+/* the first 32-bit value of a property, 0 if it isn't set */
+static uint32_t prop32(xcb_window_t win, const char *name) {
+    xcb_intern_atom_reply_t *a = xcb_intern_atom_reply(
+        conn, xcb_intern_atom(conn, 0, strlen(name), name), NULL);
+    xcb_get_property_reply_t *p = NULL;
+    uint32_t value = 0;
+
+    if (a)
+        p = xcb_get_property_reply(
+            conn,
+            xcb_get_property(conn, 0, win, a->atom, XCB_GET_PROPERTY_TYPE_ANY,
+                             0, 1),
+            NULL);
+    if (p && p->format == 32 && xcb_get_property_value_length(p) == 4)
+        value = *(uint32_t *)xcb_get_property_value(p);
+    free(p);
+    free(a);
+    return value;
+}
+
+/* a window manager is running: it has set _NET_SUPPORTING_WM_CHECK */
+static bool wm_running(void) {
+    return prop32(screen->root, "_NET_SUPPORTING_WM_CHECK") != 0;
+}
+
+/* tfwm sets _NET_WM_PID on its check window */
+static pid_t wm_pid(void) {
+    return prop32(prop32(screen->root, "_NET_SUPPORTING_WM_CHECK"),
+                  "_NET_WM_PID");
+}
+
+static void report(const char *what, double value, const char *unit) {
+    printf("%-32s %12.2f %s\n", what, value, unit);
+    if (json)
+        fprintf(json,
+                "{\"bench\": \"%s\", \"n\": %d, \"what\": \"%s\", "
+                "\"value\": %.2f, \"unit\": \"%s\"}\n",
+                bench_name, bench_n, what, value, unit);
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    const uint64_t ua = *(const uint64_t *)a, ub = *(const uint64_t *)b;
+
+    return (ua > ub) - (ua < ub);
+}
+
+/* median and p99 of n samples in ns, as us; sorts them */
+static void report_samples(const char *what, uint64_t *ns, int n) {
+    char name[64];
+
+    if (n <= 0)
+        return;
+    qsort(ns, n, sizeof(*ns), cmp_u64);
+    snprintf(name, sizeof(name), "%s p50", what);
+    report(name, ns[n / 2] / 1e3, "us");
+    snprintf(name, sizeof(name), "%s p99", what);
+    report(name, ns[(n * 99) / 100] / 1e3, "us");
+}
+
+/* how long a fence takes by itself, to subtract from batches */
+static uint64_t fence_cost(void) {
+    uint64_t start, best = UINT64_MAX;
+
+    for (int i = 0; i < 5; i++) {
+        start = now();
+        fence();
+        if (now() - start < best)
+            best = now() - start;
+    }
+    return best;
+}
+
+/* the mean of count bindings, typed in a batch and fenced */
+static void report_batch(const char *what, unsigned int mods,
+                         const xcb_keysym_t *syms, int nsyms, int count,
+                         uint64_t fenced) {
+    const uint64_t start = now();
+
+    for (int i = 0; i < count; i++)
+        press(mods, syms[i % nsyms]);
+    fence();
+    report(what, (double)(now() - start - fenced) / count / 1e3, "us");
+}
+
+/* drag a frame by its middle with button 1 and MOD_MASK_1 held, through
+ * a few steps */
+static void drag(xcb_window_t frame) {
+    xcb_get_geometry_reply_t *g =
+        xcb_get_geometry_reply(conn, xcb_get_geometry(conn, frame), NULL);
+    int16_t x, y;
+
+    if (!g)
+        return;
+    x = g->x + g->width / 2;
+    y = g->y + g->height / 2;
+    free(g);
+    xcb_test_fake_input(conn, XCB_MOTION_NOTIFY, 0, XCB_CURRENT_TIME,
+                        screen->root, x, y, 0);
+    fake_key(XCB_KEY_PRESS, XK_Alt_L);
+    xcb_test_fake_input(conn, XCB_BUTTON_PRESS, 1, XCB_CURRENT_TIME, XCB_NONE,
+                        0, 0, 0);
+    for (int i = 1; i <= 8; i++)
+        xcb_test_fake_input(conn, XCB_MOTION_NOTIFY, 0, XCB_CURRENT_TIME,
+                            screen->root, x + 8 * i, y + 4 * i, 0);
+    xcb_test_fake_input(conn, XCB_BUTTON_RELEASE, 1, XCB_CURRENT_TIME,
+                        XCB_NONE, 0, 0, 0);
+    fake_key(XCB_KEY_RELEASE, XK_Alt_L);
+}
+
+/* wait up to five seconds for the window manager to come up */
+static int bench_wait(int n) {
+    (void)n;
+    for (int i = 0; i < 50; i++) {
+        if (wm_running())
+            return 0;
+        usleep(100000);
+    }
+    fprintf(stderr, "bench: no window manager\n");
+    return 1;
+}
+
+/* bindings that spawn, handled per second, and the window manager's
+ * latency with the spawns in flight: a fence every batch, against one
+ * taken idle. F2 is bound to amixer, which bench/run.sh shadows with
+ * true in tfwm's PATH; anywhere else this would turn the volume up. */
+static int bench_spawn(int n) {
+    const int batch = 10;
+    uint64_t *ns, idle, start, t;
+    int samples = 0;
+
+    if (!getenv("TFWM_BENCH_BIN")) {
+        fprintf(stderr, "bench: spawn only runs under bench/run.sh\n");
+        return 1;
+    }
+    if (!(ns = malloc((n / batch + 1) * sizeof(*ns))))
+        return 1;
+    idle = fence_cost();
+    start = now();
+    for (int i = 0; i < n; i++) {
+        press(0, XK_F2);
+        if ((i + 1) % batch == 0) {
+            t = now();
+            fence();
+            ns[samples++] = now() - t;
+        }
+    }
+    fence();
+    report("spawn", n / ((now() - start) / 1e9), "spawns/s");
+    report("spawn fence idle", idle / 1e3, "us");
+    report_samples("spawn fence in flight", ns, samples);
+    free(ns);
+    return 0;
+}
+
+/* a client rewriting its title and size hints as fast as it can. the
+ * title is of no interest to the window manager and the hints coalesce,
+ * so this should cost far less than a configure per change. */
+static int bench_props(int n) {
+    const xcb_window_t win = map(100, 100, 400, 300);
+    uint32_t hints[18] = {0};
+    char title[32];
+    uint64_t start;
+
+    hints[0] = 1 << 4; /* PMinSize */
+    start = now();
+    for (int i = 0; i < n; i++) {
+        const int len = snprintf(title, sizeof(title), "bench %d", i);
+        xcb_change_property(conn, XCB_PROP_MODE_REPLACE, win,
+                            XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8, len, title);
+        hints[5] = 100 + i % 100; /* min width */
+        hints[6] = 100 + i % 50;  /* min height */
+        xcb_change_property(conn, XCB_PROP_MODE_REPLACE, win,
+                            XCB_ATOM_WM_NORMAL_HINTS, XCB_ATOM_WM_SIZE_HINTS,
+                            32, LENGTH(hints), hints);
+    }
+    fence();
+    report("props", 2 * n / ((now() - start) / 1e9), "changes/s");
+    xcb_destroy_window(conn, win);
+    return 0;
+}
+
+/* take every path that has a round trip budget in stats.c: manage and
+ * focus by mapping, enter notify by moving the pointer over the frames,
+ * and key press by switching workspaces. bench/run.sh checks the dump. */
+static int bench_budget(int n) {
+    xcb_window_t wins[8];
+
+    for (int i = 0; i < LENGTH(wins); i++)
+        wins[i] = map(60 * i, 60 * i, 300, 200);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < LENGTH(wins); j++)
+            xcb_test_fake_input(conn, XCB_MOTION_NOTIFY, 0, XCB_CURRENT_TIME,
+                                screen->root, 60 * j + 150, 60 * j + 100, 0);
+        press(MOD, XK_2);
+        press(MOD, XK_1);
+    }
+    fence();
+    for (int i = 0; i < LENGTH(wins); i++)
+        xcb_destroy_window(conn, wins[i]);
+    xcb_flush(conn);
+    return 0;
+}
+
+/* the columns of tfwm-resources.tsv read back */
+enum { RES_RSS = 1, RES_BYTES = 5, RES_REQUESTS = 9, RES_FIELDS };
+
+static int read_rows(const char *path, char *last, size_t size) {
+    FILE *f = fopen(path, "r");
+    char line[256];
+    int rows = 0;
+
+    if (!f)
+        return 0;
+    while (fgets(line, sizeof(line), f)) {
+        snprintf(last, size, "%s", line);
+        rows++;
+    }
+    fclose(f);
+    return rows;
+}
+
+/* have tfwm append a row to tfwm-resources.tsv and read it back */
+static bool resources(pid_t pid, double *f) {
+    const char *dir = getenv("XDG_RUNTIME_DIR");
+    char path[256], last[256] = "";
+    int rows;
+
+    if (!dir || pid <= 0)
+        return false;
+    snprintf(path, sizeof(path), "%s/tfwm-resources.tsv", dir);
+    rows = read_rows(path, last, sizeof(last));
+    kill(pid, SIGUSR1);
+    for (int i = 0; i < 500; i++) {
+        if (read_rows(path, last, sizeof(last)) > rows) {
+            char *p = last;
+            for (int k = 0; k < RES_FIELDS; k++)
+                f[k] = strtod(p, &p);
+            return true;
+        }
+        usleep(10000);
+    }
+    fprintf(stderr, "bench: no row in %s\n", path);
+    return false;
+}
+
+/* what grows with the number of clients: map n windows one at a time,
+ * timing each until it is framed, then switch workspaces and cycle focus
+ * with all of them managed, then close them all at once. the memory and
+ * X requests each client costs come from tfwm-resources.tsv. */
+static int scale(int n) {
+    const xcb_keysym_t ws[] = {XK_2, XK_1}, tab[] = {XK_Tab};
+    const int tenth = n / 10 > 0 ? n / 10 : 1;
+    const pid_t pid = wm_pid();
+    double before[RES_FIELDS], mapped[RES_FIELDS], after[RES_FIELDS];
+    xcb_window_t *wins;
+    uint64_t *ns, start, fenced;
+    char what[64];
+
+    bench_n = n;
+    if (!resources(pid, before))
+        return 1;
+    if (!(wins = malloc(n * sizeof(*wins))) || !(ns = malloc(n * sizeof(*ns))))
+        return 1;
+
+    for (int i = 0; i < n; i++) {
+        start = now();
+        wins[i] = map(i % 64 * 16, i % 48 * 16, 320, 240);
+        ns[i] = now() - start;
+    }
+    snprintf(what, sizeof(what), "map, first %d", tenth);
+    report_samples(what, ns, tenth);
+    snprintf(what, sizeof(what), "map, last %d of %d", tenth, n);
+    report_samples(what, ns + n - tenth, tenth);
+    if (!resources(pid, mapped))
+        return 1;
+    snprintf(what, sizeof(what), "heap per client, %d clients", n);
+    report(what, (mapped[RES_BYTES] - before[RES_BYTES]) / n, "bytes");
+    snprintf(what, sizeof(what), "rss per client, %d clients", n);
+    report(what, (mapped[RES_RSS] - before[RES_RSS]) * 1024 / n, "bytes");
+    snprintf(what, sizeof(what), "requests per map, %d clients", n);
+    report(what, (mapped[RES_REQUESTS] - before[RES_REQUESTS]) / n,
+           "requests");
+
+    fenced = fence_cost();
+    snprintf(what, sizeof(what), "workspace switch, %d clients", n);
+    report_batch(what, MOD, ws, LENGTH(ws), 100, fenced);
+    snprintf(what, sizeof(what), "focus cycle, %d clients", n);
+    report_batch(what, MOD, tab, LENGTH(tab), 100, fenced);
+
+    start = now();
+    for (int i = 0; i < n; i++)
+        xcb_destroy_window(conn, wins[i]);
+    fence();
+    snprintf(what, sizeof(what), "unmanage, %d clients", n);
+    report(what, (double)(now() - start - fenced) / n / 1e3, "us");
+    if (!resources(pid, after))
+        return 1;
+    snprintf(what, sizeof(what), "requests, %d clients", n);
+    report(what, after[RES_REQUESTS] - before[RES_REQUESTS], "requests");
+
+    free(wins);
+    free(ns);
+    return 0;
+}
+
+/* scale at n clients, or over a sweep of them if n is 0 */
+static int bench_scale(int n) {
+    static const int sweep[] = {10, 100, 1000, 5000};
+
+    if (n > 0)
+        return scale(n);
+    for (int i = 0; i < LENGTH(sweep); i++)
+        if (scale(sweep[i]))
+            return 1;
+    return 0;
+}
+
+/* where the events an input action shows up as are seen */
+enum { ON_FRAME, ON_WINDOWS, ON_ROOT };
+
+/* from the XTest request to what the action makes the server send, per
+ * action: the latency a user sees, through the server and back. frames
+ * move, the window focus goes to gets FocusIn and the root its new
+ * _NET_ACTIVE_WINDOW. each pair of keys undoes itself, and every sample
+ * is fenced and drained so stray events don't end the next one early.
+ * last, a drag with button 1, timed from each motion to the move. */
+static int bench_input(int n) {
+    static const struct {
+        const char *name;
+        unsigned int mods;
+        xcb_keysym_t keys[2];
+        uint8_t type;
+        int on;
+    } actions[] = {
+        {"input move", MOD, {XK_j, XK_k}, XCB_CONFIGURE_NOTIFY, ON_FRAME},
+        {"input resize", MOD | SHIFT, {XK_j, XK_k}, XCB_CONFIGURE_NOTIFY,
+         ON_FRAME},
+        {"input teleport", MOD, {XK_y, XK_n}, XCB_CONFIGURE_NOTIFY, ON_FRAME},
+        {"input maximize", MOD, {XK_a, XK_a}, XCB_CONFIGURE_NOTIFY, ON_FRAME},
+        {"input workspace", MOD, {XK_2, XK_1}, XCB_CONFIGURE_NOTIFY,
+         ON_FRAME},
+        {"input focus cycle", MOD, {XK_Tab, XK_Tab}, XCB_FOCUS_IN,
+         ON_WINDOWS},
+        {"input active window", MOD, {XK_Tab, XK_Tab}, XCB_PROPERTY_NOTIFY,
+         ON_ROOT},
+    };
+    const uint32_t focus_mask = XCB_EVENT_MASK_STRUCTURE_NOTIFY |
+                                XCB_EVENT_MASK_FOCUS_CHANGE;
+    const uint32_t root_mask = XCB_EVENT_MASK_PROPERTY_CHANGE;
+    /* the second one is there for focus to cycle to, off the first */
+    const xcb_window_t wins[] = {map(200, 200, 400, 300),
+                                 map(900, 500, 400, 300)};
+    const xcb_window_t frame = frame_of(wins[0]);
+    xcb_get_geometry_reply_t *g;
+    uint64_t *ns, start;
+    int16_t x, y;
+
+    if (!frame || !(ns = malloc(n * sizeof(*ns))))
+        return 1;
+    for (int i = 0; i < LENGTH(wins); i++)
+        xcb_change_window_attributes(conn, wins[i], XCB_CW_EVENT_MASK,
+                                     &focus_mask);
+    xcb_change_window_attributes(conn, screen->root, XCB_CW_EVENT_MASK,
+                                 &root_mask);
+    for (int a = 0; a < LENGTH(actions); a++) {
+        for (int i = 0; i < n; i++) {
+            start = now();
+            press(actions[a].mods, actions[a].keys[i % 2]);
+            if (actions[a].on == ON_FRAME)
+                wait_for(actions[a].type, frame);
+            else if (actions[a].on == ON_WINDOWS)
+                wait_any(actions[a].type, wins, LENGTH(wins));
+            else
+                wait_for(actions[a].type, screen->root);
+            ns[i] = now() - start;
+            fence();
+            drain();
+        }
+        report_samples(actions[a].name, ns, n);
+    }
+
+    /* press on the frame's middle, let the raise and focus settle, then
+     * move back and forth with the button held */
+    if (!(g = xcb_get_geometry_reply(conn, xcb_get_geometry(conn, frame),
+                                     NULL))) {
+        free(ns);
+        return 1;
+    }
+    x = g->x + g->width / 2;
+    y = g->y + g->height / 2;
+    free(g);
+    xcb_test_fake_input(conn, XCB_MOTION_NOTIFY, 0, XCB_CURRENT_TIME,
+                        screen->root, x, y, 0);
+    fake_key(XCB_KEY_PRESS, XK_Alt_L);
+    xcb_test_fake_input(conn, XCB_BUTTON_PRESS, 1, XCB_CURRENT_TIME, XCB_NONE,
+                        0, 0, 0);
+    fence();
+    drain();
+    for (int i = 0; i < n; i++) {
+        start = now();
+        xcb_test_fake_input(conn, XCB_MOTION_NOTIFY, 0, XCB_CURRENT_TIME,
+                            screen->root, x + (i % 2 ? 0 : 32), y, 0);
+        wait_for(XCB_CONFIGURE_NOTIFY, frame);
+        ns[i] = now() - start;
+        fence();
+        drain();
+    }
+    xcb_test_fake_input(conn, XCB_BUTTON_RELEASE, 1, XCB_CURRENT_TIME,
+                        XCB_NONE, 0, 0, 0);
+    fake_key(XCB_KEY_RELEASE, XK_Alt_L);
+    report_samples("input drag", ns, n);
+
+    free(ns);
+    for (int i = 0; i < LENGTH(wins); i++)
+        xcb_destroy_window(conn, wins[i]);
+    xcb_flush(conn);
+    return 0;
+}
+
+/* n rounds of what a long session does: map a batch of windows, churn
+ * their properties, drag and close them, then have tfwm append a row to
+ * tfwm-resources.tsv. bench/run.sh checks the rows for growth. */
+static int bench_soak(int n) {
+    const pid_t pid = wm_pid();
+    xcb_window_t wins[32];
+    char title[32];
+
+    if (pid <= 0) {
+        fprintf(stderr, "bench: can't find the window manager's pid\n");
+        return 1;
+    }
+    for (int round = 0; round < n; round++) {
+        for (int i = 0; i < LENGTH(wins); i++)
+            wins[i] = map(i * 24, i * 16, 320, 240);
+        for (int i = 0; i < LENGTH(wins); i++) {
+            const int len = snprintf(title, sizeof(title), "soak %d", round);
+            xcb_change_property(conn, XCB_PROP_MODE_REPLACE, wins[i],
+                                XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8, len,
+                                title);
+            press(MOD, XK_Tab);
+        }
+        drag(frame_of(wins[LENGTH(wins) - 1]));
+        for (int i = 0; i < LENGTH(wins); i++)
+            xcb_destroy_window(conn, wins[i]);
+        fence();
+        drain();
+        kill(pid, SIGUSR1);
+        fence();
+    }
+    report("soak", n, "rounds");
+    return 0;
+}
+
+static const struct {
+    const char *name;
+    int (*func)(int n);
+    int n;
+} benches[] = {
+    {"wait", bench_wait, 0},
+    {"spawn", bench_spawn, 200},
+    {"props", bench_props, 5000},
+    {"budget", bench_budget, 20},
+    {"scale", bench_scale, 0},
+    {"input", bench_input, 100},
+    {"soak", bench_soak, 50},
+};
+
+int main(int argc, char **argv) {
+    int i, n;
+
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "usage: %s bench [n]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    for (i = 0; i < LENGTH(benches); i++)
+        if (strcmp(argv[1], benches[i].name) == 0)
+            break;
+    if (i == LENGTH(benches)) {
+        fprintf(stderr, "%s: no bench %s\n", argv[0], argv[1]);
+        return EXIT_FAILURE;
+    }
+    n = argc == 3 ? atoi(argv[2]) : benches[i].n;
+    bench_name = benches[i].name;
+    bench_n = n;
+    if (getenv("BENCH_JSON") && !(json = fopen(getenv("BENCH_JSON"), "a"))) {
+        fprintf(stderr, "%s: can't open %s\n", argv[0], getenv("BENCH_JSON"));
+        return EXIT_FAILURE;
+    }
+
+    conn = xcb_connect(NULL, NULL);
+    if (xcb_connection_has_error(conn)) {
+        fprintf(stderr, "%s: can't open the display\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    screen = xcb_setup_roots_iterator(xcb_get_setup(conn)).data;
+    keysyms = xcb_key_symbols_alloc(conn);
+
+    const int rc = benches[i].func(n);
+
+    xcb_key_symbols_free(keysyms);
+    xcb_disconnect(conn);
+    if (json)
+        fclose(json);
+    return rc;
+}
@@ -0,0 +1,625 @@
+/* See LICENSE file for copyright and license details. */
+/* time the window manager's own code in process, with no server: all of
+ * tfwm but main.c is linked in, and bench/model.c stands in for the
+ * server behind backend.h. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../main.h"
+#include "../list.h"
+#include "../client.h"
+#include "../config.h"
+#include "../geom.h"
+#include "../place.h"
+#include "../workspace.h"
+#include "model.h"
+
+static uint64_t now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void report(const char *what, double value, const char *unit) {
+    printf("%-32s %12.2f %s\n", what, value, unit);
+}
+
+/* fill n slab clients with frames strewn over a screen of sw by sh and
+ * four workspaces */
+static void strew(int n, int sw, int sh) {
+    for (int i = 0; i < n; i++) {
+        Client *c = client_alloc();
+        c->win = c->frame = i + 1;
+        c->ws = i % 4;
+        c->geom = (xcb_rectangle_t){rand() % sw, rand() % sh,
+                                    100 + rand() % 800, 100 + rand() % 600};
+        attach(c);
+        attachstack(c);
+        geom_add(c);
+    }
+}
+
+static void unstrew(void) {
+    while (clients) {
+        Client *c = clients;
+        detach(c);
+        detachstack(c);
+        geom_remove(c);
+        client_free(c);
+    }
+}
+
+/* what showhide() and a focus walk read of each client */
+static unsigned int walk(const Client *c) {
+    unsigned int sum = 0;
+
+    for (; c; c = c->next)
+        if (c->ws == selws && !c->noborder)
+            sum += c->geom.x + c->geom.width + c->ewmh_flags;
+    return sum;
+}
+
+/* ns per client, over some 20 million client visits */
+static double time_walks(const Client *list, int n) {
+    const int rounds = 20000000 / n + 1;
+    volatile unsigned int sink = 0;
+    const uint64_t start = now();
+
+    for (int i = 0; i < rounds; i++)
+        sink += walk(list);
+    (void)sink;
+    return (double)(now() - start) / ((double)rounds * n);
+}
+
+/* n clients from the slabs, against n taken one at a time from malloc
+ * in between other allocations, as they were before, and linked in a
+ * shuffled order, as a long session leaves them */
+static int bench_walk(int n) {
+    Client **scattered, *list = NULL;
+    void **filler;
+    char what[64];
+
+    if (!(scattered = malloc(n * sizeof(*scattered))) ||
+        !(filler = malloc(n * sizeof(*filler))))
+        return 1;
+    for (int i = 0; i < n; i++) {
+        Client *c = client_alloc();
+        c->win = c->frame = i + 1;
+        c->geom.x = i;
+        attach(c);
+        attachstack(c);
+        geom_add(c);
+        if (!(scattered[i] = calloc(1, sizeof(Client))) ||
+            !(filler[i] = malloc(64 + rand() % 512)))
+            return 1;
+        scattered[i]->geom.x = i;
+    }
+    for (int i = n - 1; i > 0; i--) {
+        const int j = rand() % (i + 1);
+        Client *t = scattered[i];
+        scattered[i] = scattered[j];
+        scattered[j] = t;
+    }
+    for (int i = 0; i < n; i++) {
+        scattered[i]->next = list;
+        list = scattered[i];
+    }
+
+    snprintf(what, sizeof(what), "walk, %d slab clients", n);
+    report(what, time_walks(clients, n), "ns/client");
+    snprintf(what, sizeof(what), "walk, %d malloc clients", n);
+    report(what, time_walks(list, n), "ns/client");
+
+    unstrew();
+    for (int i = 0; i < n; i++) {
+        free(scattered[i]);
+        free(filler[i]);
+    }
+    free(scattered);
+    free(filler);
+    return 0;
+}
+
+/* fit_all_in_screen()'s pick of the clients to fix, over the clients
+ * where they are, as it was */
+static uint32_t misfits_clients(int32_t sw, int32_t sh, Client **out) {
+    uint32_t n = 0;
+
+    for (Client *c = clients; c; c = c->next)
+        if (c->geom.x != MAX(0, MIN(c->geom.x, sw - BWIDTH(c))) ||
+            c->geom.y != MAX(0, MIN(c->geom.y, sh - BHEIGHT(c))) ||
+            c->geom.width >= sw - 2 * border_width ||
+            c->geom.height >= sh - 2 * border_width)
+            out[n++] = c;
+    return n;
+}
+
+/* and place.c's of the frames on a workspace that reach the screen */
+static uint32_t intersecting_clients(const xcb_rectangle_t *r,
+                                     unsigned int ws, Client **out) {
+    uint32_t n = 0;
+
+    for (Client *c = clients; c; c = c->next) {
+        const xcb_rectangle_t f = geom_frame(c);
+        if (c->ws == ws && f.x < r->x + r->width && r->x < f.x + f.width &&
+            f.y < r->y + r->height && r->y < f.y + f.height)
+            out[n++] = c;
+    }
+    return n;
+}
+
+#ifdef __AVX2__
+#define VECTORS "avx2"
+#elif defined(__SSE2__)
+#define VECTORS "sse2"
+#else
+#define VECTORS "scalar"
+#endif
+
+/* ns per client for the batch queries at n clients and at ten times
+ * that, client by client and from the geometry store. frames strewn over
+ * a 4k screen are checked against 1080p. both ways have to find the same
+ * clients. */
+static int bench_batch(int n) {
+    const xcb_rectangle_t screen_rect = {0, 0, 1920, 1080};
+    Client **out;
+    uint32_t found[2];
+    uint64_t start;
+    char what[64];
+    volatile uint32_t sink = 0;
+
+    for (int m = n; m <= 10 * n; m *= 10) {
+        const int rounds = 20000000 / m + 1;
+
+        if (!(out = malloc(m * sizeof(*out))))
+            return 1;
+        strew(m, 3840, 2160);
+
+        start = now();
+        for (int i = 0; i < rounds; i++)
+            sink += found[0] = misfits_clients(1920, 1080, out);
+        snprintf(what, sizeof(what), "misfits, %d clients", m);
+        report(what, (double)(now() - start) / ((double)rounds * m),
+               "ns/client");
+        start = now();
+        for (int i = 0; i < rounds; i++)
+            sink += found[1] = geom_misfits(1920, 1080, out);
+        snprintf(what, sizeof(what), "misfits, %d stored, " VECTORS, m);
+        report(what, (double)(now() - start) / ((double)rounds * m),
+               "ns/client");
+        if (found[0] != found[1]) {
+            fprintf(stderr, "misfits: %u clients, %u stored\n", found[0],
+                    found[1]);
+            return 1;
+        }
+
+        start = now();
+        for (int i = 0; i < rounds; i++)
+            sink += found[0] = intersecting_clients(&screen_rect, 1, out);
+        snprintf(what, sizeof(what), "intersect, %d clients", m);
+        report(what, (double)(now() - start) / ((double)rounds * m),
+               "ns/client");
+        start = now();
+        for (int i = 0; i < rounds; i++)
+            sink += found[1] = geom_intersecting(&screen_rect, 1, out);
+        snprintf(what, sizeof(what), "intersect, %d stored, " VECTORS, m);
+        report(what, (double)(now() - start) / ((double)rounds * m),
+               "ns/client");
+        if (found[0] != found[1]) {
+            fprintf(stderr, "intersecting: %u clients, %u stored\n",
+                    found[0], found[1]);
+            return 1;
+        }
+
+        unstrew();
+        free(out);
+    }
+    (void)sink;
+    return 0;
+}
+
+static void nearer(int32_t e, int32_t pos, int32_t *best, int32_t *best_dist) {
+    const int32_t d = abs(e - pos);
+
+    if (d < *best_dist || (d == *best_dist && e < *best)) {
+        *best = e;
+        *best_dist = d;
+    }
+}
+
+/* the edge geom_snap() finds, from a walk of every client on a 1080p
+ * screen */
+static int32_t snap_clients(int axis, int32_t pos, const xcb_rectangle_t *r,
+                            int32_t dist, const Client *skip) {
+    const int32_t from = axis == GEOM_X ? r->y : r->x;
+    const int32_t to = from + (axis == GEOM_X ? r->height : r->width);
+    int32_t best = INT32_MIN, best_dist = dist + 1;
+
+    if (from < (axis == GEOM_X ? 1080 : 1920) && 0 < to) {
+        nearer(0, pos, &best, &best_dist);
+        nearer(axis == GEOM_X ? 1920 : 1080, pos, &best, &best_dist);
+    }
+    for (const Client *c = clients; c; c = c->next) {
+        const xcb_rectangle_t f = geom_frame(c);
+        const int32_t a = axis == GEOM_X ? f.x : f.y;
+        const int32_t len = axis == GEOM_X ? f.width : f.height;
+        const int32_t other = axis == GEOM_X ? f.y : f.x;
+        const int32_t other_len = axis == GEOM_X ? f.height : f.width;
+
+        if (c == skip || !ISVISIBLE(c) || other >= to ||
+            from >= other + other_len)
+            continue;
+        nearer(a, pos, &best, &best_dist);
+        nearer(a + len, pos, &best, &best_dist);
+    }
+    return best_dist <= dist ? best : pos;
+}
+
+/* ns per snap of a dragged frame with n frames over four workspaces,
+ * from the grid and from a walk of the clients, which have to agree */
+static int bench_snap(int n) {
+    const int rounds = 200000;
+    struct {
+        int axis;
+        int32_t pos;
+        xcb_rectangle_t r;
+    } *q;
+    volatile int32_t sink = 0;
+    uint64_t start, ns[2];
+    char what[64];
+
+    if (!(q = malloc(rounds * sizeof(*q))))
+        return 1;
+    strew(n, 1920, 1080);
+    for (int i = 0; i < rounds; i++) {
+        q[i].axis = i % 2;
+        q[i].pos = rand() % 1920;
+        q[i].r = (xcb_rectangle_t){rand() % 1920, rand() % 1080,
+                                   100 + rand() % 800, 100 + rand() % 600};
+    }
+    for (int i = 0; i < rounds; i++) {
+        if (geom_snap(q[i].axis, q[i].pos, &q[i].r, 16, clients) !=
+            snap_clients(q[i].axis, q[i].pos, &q[i].r, 16, clients)) {
+            fprintf(stderr, "snap: the grid and the walk differ\n");
+            return 1;
+        }
+    }
+
+    start = now();
+    for (int i = 0; i < rounds; i++)
+        sink += geom_snap(q[i].axis, q[i].pos, &q[i].r, 16, clients);
+    ns[0] = now() - start;
+    start = now();
+    for (int i = 0; i < rounds; i++)
+        sink += snap_clients(q[i].axis, q[i].pos, &q[i].r, 16, clients);
+    ns[1] = now() - start;
+    snprintf(what, sizeof(what), "snap, %d frames, grid", n);
+    report(what, (double)ns[0] / rounds, "ns");
+    snprintf(what, sizeof(what), "snap, %d frames, walk", n);
+    report(what, (double)ns[1] / rounds, "ns");
+
+    /* what keeping the grid costs a frame that moves */
+    start = now();
+    for (int i = 0; i < rounds;) {
+        for (Client *c = clients; c && i < rounds; c = c->next, i++) {
+            c->geom.x = q[i].r.x;
+            c->geom.y = q[i].r.y;
+            geom_update(c);
+        }
+    }
+    snprintf(what, sizeof(what), "snap, %d frames, update", n);
+    report(what, (double)(now() - start) / rounds, "ns");
+
+    (void)sink;
+    unstrew();
+    free(q);
+    return 0;
+}
+
+static int32_t gap(int32_t a, int32_t alen, int32_t b, int32_t blen) {
+    if (b >= a + alen)
+        return b - (a + alen);
+    if (a >= b + blen)
+        return a - (b + blen);
+    return 0;
+}
+
+/* the frame geom_neighbor() finds, from a walk of the stack */
+static Client *neighbor_walk(const Client *c, int direction) {
+    const xcb_rectangle_t r = geom_frame(c);
+    const int32_t cx = r.x + r.width / 2, cy = r.y + r.height / 2;
+    Client *best = NULL;
+    int64_t best_score = INT64_MAX;
+
+    for (Client *t = stack; t; t = t->snext) {
+        const xcb_rectangle_t f = geom_frame(t);
+        const int32_t dx = f.x + f.width / 2 - cx;
+        const int32_t dy = f.y + f.height / 2 - cy;
+        const bool across_x = direction == Left || direction == Right;
+        const int32_t along = across_x ? (direction == Left ? -dx : dx)
+                                       : (direction == Top ? -dy : dy);
+        const int32_t across = across_x ? gap(r.y, r.height, f.y, f.height)
+                                        : gap(r.x, r.width, f.x, f.width);
+        const int64_t score = (int64_t)along + 2 * (int64_t)across;
+
+        if (t != c && ISVISIBLE(t) && along > 0 && score < best_score) {
+            best = t;
+            best_score = score;
+        }
+    }
+    return best;
+}
+
+/* ns per directional focus query with n frames over four workspaces,
+ * from the grid and from a walk of the stack, which have to agree */
+static int bench_neighbor(int n) {
+    static const int directions[] = {Left, Right, Top, Bottom};
+    const int rounds = 200000;
+    Client **shown;
+    int nshown = 0;
+    uint64_t start, ns[2];
+    char what[64];
+    volatile uintptr_t sink = 0;
+
+    if (!(shown = malloc(n * sizeof(*shown))))
+        return 1;
+    strew(n, 1920, 1080);
+    for (Client *c = clients; c; c = c->next)
+        if (ISVISIBLE(c))
+            shown[nshown++] = c;
+    for (int i = 0; i < rounds; i++) {
+        Client *c = shown[i % nshown];
+        const int d = directions[i % 4];
+        if (geom_neighbor(c, d) != neighbor_walk(c, d)) {
+            fprintf(stderr, "neighbor: the grid and the walk differ\n");
+            return 1;
+        }
+    }
+
+    start = now();
+    for (int i = 0; i < rounds; i++)
+        sink += (uintptr_t)geom_neighbor(shown[i % nshown], directions[i % 4]);
+    ns[0] = now() - start;
+    start = now();
+    for (int i = 0; i < rounds; i++)
+        sink += (uintptr_t)neighbor_walk(shown[i % nshown], directions[i % 4]);
+    ns[1] = now() - start;
+    snprintf(what, sizeof(what), "neighbor, %d frames, grid", n);
+    report(what, (double)ns[0] / rounds, "ns");
+    snprintf(what, sizeof(what), "neighbor, %d frames, walk", n);
+    report(what, (double)ns[1] / rounds, "ns");
+
+    (void)sink;
+    unstrew();
+    free(shown);
+    return 0;
+}
+
+/* map n windows one after another onto one workspace with each policy
+ * that scans the frames already there, and time the placement of the
+ * last tenth: about n frames to fit around */
+static int bench_place(int n) {
+    static const struct {
+        const char *name;
+        int policy;
+    } policies[] = {
+        {"place first fit", PLACE_FIRST_FIT},
+        {"place overlap", PLACE_OVERLAP},
+    };
+    const int tenth = n / 10 > 0 ? n / 10 : 1;
+    const int saved = placement;
+    uint64_t start, total;
+    char what[64];
+
+    for (int p = 0; p < LENGTH(policies); p++) {
+        placement = policies[p].policy;
+        srand(1);
+        total = 0;
+        for (int i = 0; i < n; i++) {
+            Client *c = client_alloc();
+            c->win = c->frame = i + 1;
+            c->geom.width = 200 + rand() % 400;
+            c->geom.height = 150 + rand() % 300;
+            start = now();
+            place_client(c);
+            if (i >= n - tenth)
+                total += now() - start;
+            attach(c);
+            attachstack(c);
+            geom_add(c);
+        }
+        snprintf(what, sizeof(what), "%s, %d frames", policies[p].name, n);
+        report(what, (double)total / tenth / 1e3, "us");
+        unstrew();
+    }
+    placement = saved;
+    return 0;
+}
+
+/* manage n windows, strewn over the screen and over four workspaces.
+ * returns the ns each took. */
+static double populate(int n) {
+    uint64_t total = 0, start;
+
+    for (int i = 0; i < n; i++) {
+        const xcb_window_t win =
+            model_window(rand() % 1600, rand() % 800, 100 + rand() % 600,
+                         100 + rand() % 400);
+        selws = i % 4;
+        start = now();
+        manage(win);
+        total += now() - start;
+    }
+    selws = 0;
+    return (double)total / n;
+}
+
+static void unpopulate(void) {
+    while (clients)
+        unmanage(clients);
+}
+
+/* the clients on the workspace shown, top of the stack first */
+static int visible(Client **out, int max) {
+    int n = 0;
+
+    for (Client *c = stack; c && n < max; c = c->snext)
+        if (ISVISIBLE(c))
+            out[n++] = c;
+    return n;
+}
+
+/* ns and requests per call of what fn does to the clients shown, taken
+ * in turn, over rounds calls */
+static void time_clients(const char *name, int n, int rounds,
+                         void (*fn)(Client *c, int i)) {
+    Client *shown[256];
+    const int k = visible(shown, LENGTH(shown));
+    const unsigned int requests = model_requests();
+    const uint64_t start = now();
+    char what[64];
+
+    if (k == 0)
+        return;
+    for (int i = 0; i < rounds; i++)
+        fn(shown[i % k], i);
+    snprintf(what, sizeof(what), "%s, %d clients", name, n);
+    report(what, (double)(now() - start) / rounds, "ns");
+    snprintf(what, sizeof(what), "%s requests", name);
+    report(what, (double)(model_requests() - requests) / rounds, "per call");
+}
+
+static void do_focus(Client *c, int i) {
+    (void)i;
+    focus(c);
+}
+
+static void do_teleport(Client *c, int i) {
+    teleport_client(c, i % 2 ? TopLeft : BottomRight);
+}
+
+static void do_maximize_half(Client *c, int i) {
+    static const uint16_t halves[] = {Left, Right, Top, Bottom};
+
+    maximize_half_client(c, halves[i % LENGTH(halves)]);
+}
+
+/* what handlers do to one client at a time, with n managed */
+static int bench_client(int n) {
+    const unsigned int requests = model_requests();
+    char what[64];
+    double ns;
+
+    ns = populate(n);
+    snprintf(what, sizeof(what), "manage, %d clients", n);
+    report(what, ns, "ns");
+    report("manage requests", (double)(model_requests() - requests) / n,
+           "per call");
+    time_clients("focus", n, 100000, do_focus);
+    time_clients("teleport", n, 100000, do_teleport);
+    time_clients("maximize half", n, 100000, do_maximize_half);
+    unpopulate();
+    return 0;
+}
+
+/* showhide() for a workspace switch back and forth, with n managed over
+ * four workspaces */
+static int bench_showhide(int n) {
+    const int rounds = 10000;
+    unsigned int requests;
+    uint64_t start;
+    char what[64];
+
+    populate(n);
+    requests = model_requests();
+    start = now();
+    for (int i = 0; i < rounds; i++) {
+        selws = !selws;
+        showhide(!selws, selws);
+    }
+    snprintf(what, sizeof(what), "showhide, %d clients", n);
+    report(what, (double)(now() - start) / rounds, "ns");
+    report("showhide requests", (double)(model_requests() - requests) / rounds,
+           "per call");
+    selws = 0;
+    unpopulate();
+    return 0;
+}
+
+/* list.c with n managed: a client taken off both lists and put back, and
+ * focusstack() cycling through the workspace shown */
+static int bench_list(int n) {
+    const int rounds = 100000;
+    Client **all;
+    uint64_t start;
+    char what[64];
+    int i = 0;
+
+    populate(n);
+    if (!(all = malloc(n * sizeof(*all))))
+        return 1;
+    for (Client *c = clients; c; c = c->next)
+        all[i++] = c;
+
+    start = now();
+    for (i = 0; i < rounds; i++) {
+        Client *c = all[i % n];
+        detach(c);
+        detachstack(c);
+        attach(c);
+        attachstack(c);
+    }
+    snprintf(what, sizeof(what), "detach and attach, %d clients", n);
+    report(what, (double)(now() - start) / rounds, "ns");
+
+    sel = stack;
+    start = now();
+    for (i = 0; i < rounds; i++)
+        focusstack(i % 2);
+    snprintf(what, sizeof(what), "focusstack, %d clients", n);
+    report(what, (double)(now() - start) / rounds, "ns");
+
+    free(all);
+    unpopulate();
+    return 0;
+}
+
+static const struct {
+    const char *name;
+    int (*func)(int n);
+    int n;
+} benches[] = {
+    {"walk", bench_walk, 1000},
+    {"batch", bench_batch, 1000},
+    {"snap", bench_snap, 1000},
+    {"neighbor", bench_neighbor, 1000},
+    {"place", bench_place, 100},
+    {"client", bench_client, 100},
+    {"showhide", bench_showhide, 100},
+    {"list", bench_list, 100},
+};
+
+int main(int argc, char **argv) {
+    int i, n, rc = 0;
+
+    if (argc > 3) {
+        fprintf(stderr, "usage: %s [bench [n]]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    model_setup(1920, 1080);
+    for (i = 0; i < LENGTH(benches); i++) {
+        if (argc > 1 && strcmp(argv[1], benches[i].name) != 0)
+            continue;
+        n = argc == 3 ? atoi(argv[2]) : benches[i].n;
+        if (benches[i].func(n))
+            rc = 1;
+        if (argc > 1)
+            return rc;
+    }
+    if (argc > 1) {
+        fprintf(stderr, "%s: no bench %s\n", argv[0], argv[1]);
+        return EXIT_FAILURE;
+    }
+    return rc;
+}
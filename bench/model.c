@@ -0,0 +1,749 @@
+/* See LICENSE file for copyright and license details. */
+/* an X server in memory, behind backend.h: windows with their geometry,
+ * parent, mapping, event mask and properties, the pointer and the passive
+ * grabs. every request takes a sequence number as it would on the
+ * wire, and reads are answered at once, in xcb's reply structs. there
+ * are no events. linked in place of backend.c and main.c.
+ *
+ * for bench/replay.c, reads are answered instead with what a capture
+ * says the server answered, and a drag's events come from it too. */
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../main.h"
+#include "../backend.h"
+#include "../client.h"
+#include "../log.h"
+#include "../trace.h"
+#include "model.h"
+
+/* what main.c defines */
+xcb_connection_t *conn;
+xcb_screen_t *screen;
+SnDisplay *sndisplay;
+int scrno;
+xcb_ewmh_connection_t *ewmh;
+uint32_t focus_pixel;
+uint32_t unfocus_pixel;
+xcb_atom_t WM_DELETE_WINDOW;
+xcb_atom_t WM_TAKE_FOCUS;
+xcb_atom_t WM_PROTOCOLS;
+xcb_atom_t NET_STARTUP_ID;
+xcb_atom_t WM_WINDOW_ROLE;
+xcb_timestamp_t last_timestamp;
+Client *sel;
+Client *clients;
+Client *stack;
+
+void quit(const Arg *arg) {
+    (void)arg;
+}
+
+void restart(const Arg *arg) {
+    (void)arg;
+}
+
+#define BUCKETS 4096
+#define ROOT 0x100
+/* ids the model hands out, out of the way of the root's */
+#define FIRST_ID 0x200000
+
+typedef struct Prop Prop;
+struct Prop {
+    xcb_atom_t atom, type;
+    uint8_t format;
+    uint32_t len; /* in format units */
+    uint8_t *data;
+    Prop *next;
+};
+
+typedef struct Win Win;
+struct Win {
+    xcb_window_t id, parent;
+    xcb_rectangle_t geom;
+    uint16_t border;
+    bool mapped;
+    uint32_t event_mask;
+    Prop *props;
+    Win *next; /* in its bucket */
+};
+
+static xcb_screen_t root_screen;
+static Win *windows[BUCKETS];
+static unsigned int seq, noops, next_id;
+static unsigned int key_grabs, button_grabs;
+static int16_t pointer_x, pointer_y;
+/* the keyboard map, made up as keycodes are asked for */
+static xcb_keysym_t keymap[248];
+static int nkeys;
+
+/* a capture's answers, oldest first for each request, window and atom,
+ * which is all a replay has to match a read with: its sequence number
+ * and its place among the reads needn't be what they were */
+typedef struct Answer Answer;
+struct Answer {
+    const void *data;
+    uint32_t size;
+    Answer *next;
+};
+
+typedef struct Asked Asked;
+struct Asked {
+    uint8_t request;
+    uint32_t win, atom;
+    Answer *first, **last;
+    Asked *next; /* in its bucket */
+};
+
+static Asked *asked[BUCKETS];
+static bool replaying;
+static unsigned int unanswered;
+
+/* replies not yet taken, by sequence number */
+static struct {
+    unsigned int seq;
+    void *reply;
+} *replies;
+static int nreplies, replies_size;
+
+static Win **bucket(xcb_window_t id) {
+    return &windows[(id * 2654435761u) >> 20 & (BUCKETS - 1)];
+}
+
+static Win *find(xcb_window_t id) {
+    Win *w;
+
+    for (w = *bucket(id); w && w->id != id; w = w->next)
+        ;
+    return w;
+}
+
+static Prop *find_prop(const Win *w, xcb_atom_t atom) {
+    Prop *p;
+
+    for (p = w->props; p && p->atom != atom; p = p->next)
+        ;
+    return p;
+}
+
+static void free_props(Win *w) {
+    while (w->props) {
+        Prop *p = w->props;
+        w->props = p->next;
+        free(p->data);
+        free(p);
+    }
+}
+
+static Win *add(xcb_window_t id, xcb_window_t parent,
+                const xcb_rectangle_t *r) {
+    Win **b = bucket(id), *w;
+
+    if (!(w = calloc(1, sizeof(*w))))
+        err("can't allocate memory.");
+    w->id = id;
+    w->parent = parent;
+    w->geom = *r;
+    w->next = *b;
+    *b = w;
+    return w;
+}
+
+static void remove_window(xcb_window_t id) {
+    Win **p, *w;
+
+    for (p = bucket(id); (w = *p) && w->id != id; p = &w->next)
+        ;
+    if (!w)
+        return;
+    *p = w->next;
+    free_props(w);
+    free(w);
+}
+
+/* a reply to the request just counted, for backend_reply() to find */
+static void *answer(size_t size) {
+    xcb_generic_reply_t *r;
+
+    /* as long as its length says, in words */
+    if (!(r = calloc(1, (size + 3) & ~(size_t)3)))
+        err("can't allocate memory.");
+    r->response_type = 1; /* a reply */
+    r->sequence = seq;
+    r->length = (size - 32 + 3) / 4;
+    if (nreplies == replies_size) {
+        replies_size = replies_size ? replies_size * 2 : 16;
+        if (!(replies = realloc(replies, replies_size * sizeof(*replies))))
+            err("can't allocate memory.");
+    }
+    replies[nreplies].seq = seq;
+    replies[nreplies++].reply = r;
+    return r;
+}
+
+static void *take(unsigned int s) {
+    for (int i = 0; i < nreplies; i++)
+        if (replies[i].seq == s) {
+            void *r = replies[i].reply;
+            replies[i] = replies[--nreplies];
+            return r;
+        }
+    return NULL;
+}
+
+static Asked **asked_bucket(uint8_t request, uint32_t win, uint32_t atom) {
+    return &asked[((win ^ atom << 16 ^ request) * 2654435761u) >> 20 &
+                  (BUCKETS - 1)];
+}
+
+static Asked *find_asked(uint8_t request, uint32_t win, uint32_t atom) {
+    Asked *q;
+
+    for (q = *asked_bucket(request, win, atom);
+         q && (q->request != request || q->win != win || q->atom != atom);
+         q = q->next)
+        ;
+    return q;
+}
+
+/* the oldest answer left to request on win and atom. NULL for none, or
+ * for an answer of nothing, an error. */
+static const void *recall(uint8_t request, uint32_t win, uint32_t atom,
+                          uint32_t *size) {
+    Asked *q = find_asked(request, win, atom);
+    Answer *a;
+    const void *data;
+
+    if (!q || !(a = q->first)) {
+        unanswered++;
+        return NULL;
+    }
+    if (!(q->first = a->next))
+        q->last = &q->first;
+    data = a->size ? a->data : NULL;
+    *size = a->size;
+    free(a);
+    return data;
+}
+
+/* the reply to the read just counted, from the capture */
+static void replay_reply(uint8_t request, uint32_t win, uint32_t atom) {
+    xcb_generic_reply_t *r;
+    const void *data;
+    uint32_t size;
+
+    if (!(data = recall(request, win, atom, &size)) || size < 32)
+        return;
+    r = answer(size);
+    memcpy(r, data, size);
+    r->sequence = seq;
+}
+
+void model_setup(uint16_t width, uint16_t height) {
+    xcb_atom_t *atom;
+    size_t natoms;
+
+    root_screen = (xcb_screen_t){.root = ROOT,
+                                 .width_in_pixels = width,
+                                 .height_in_pixels = height,
+                                 .root_depth = 24};
+    screen = &root_screen;
+    add(ROOT, XCB_NONE, &(xcb_rectangle_t){0, 0, width, height})->mapped =
+        true;
+    seq = noops = 0;
+    next_id = FIRST_ID;
+
+    /* the atoms are all the fields from _NET_SUPPORTED on; any distinct
+     * numbers past the predefined ones will do */
+    if (!(ewmh = calloc(1, sizeof(*ewmh))))
+        err("can't allocate memory.");
+    atom = &ewmh->_NET_SUPPORTED;
+    natoms = (sizeof(*ewmh) - offsetof(xcb_ewmh_connection_t, _NET_SUPPORTED)) /
+             sizeof(xcb_atom_t);
+    for (size_t i = 0; i < natoms; i++)
+        atom[i] = 100 + i;
+    WM_DELETE_WINDOW = 100 + natoms;
+    WM_TAKE_FOCUS = 101 + natoms;
+    WM_PROTOCOLS = ewmh->WM_PROTOCOLS;
+    NET_STARTUP_ID = 102 + natoms;
+    WM_WINDOW_ROLE = 103 + natoms;
+}
+
+void model_teardown(void) {
+    for (int i = 0; i < BUCKETS; i++) {
+        while (windows[i])
+            remove_window(windows[i]->id);
+        while (asked[i]) {
+            Asked *q = asked[i];
+            while (q->first) {
+                Answer *a = q->first;
+                q->first = a->next;
+                free(a);
+            }
+            asked[i] = q->next;
+            free(q);
+        }
+    }
+    replaying = false;
+    unanswered = 0;
+    while (nreplies > 0)
+        free(replies[--nreplies].reply);
+    FREE(replies);
+    replies_size = 0;
+    FREE(ewmh);
+}
+
+/* a top-level window, as a client would create it */
+xcb_window_t model_window(int16_t x, int16_t y, uint16_t w, uint16_t h) {
+    const xcb_window_t id = next_id++;
+
+    add(id, screen->root, &(xcb_rectangle_t){x, y, w, h});
+    return id;
+}
+
+/* answer from a capture from now on, with its root in place of ours */
+void model_replay(xcb_window_t root) {
+    const xcb_rectangle_t r = find(screen->root)->geom;
+
+    remove_window(screen->root);
+    root_screen.root = root;
+    add(root, XCB_NONE, &r)->mapped = true;
+    replaying = true;
+}
+
+/* an answer for the replay to give, in the order the capture got them.
+ * data is the caller's, and has to outlive the model. */
+void model_answer(uint8_t request, uint32_t win, uint32_t atom,
+                  const void *data, uint32_t size) {
+    Asked **b, *q;
+    Answer *a;
+
+    if (!(q = find_asked(request, win, atom))) {
+        if (!(q = calloc(1, sizeof(*q))))
+            err("can't allocate memory.");
+        q->request = request;
+        q->win = win;
+        q->atom = atom;
+        q->last = &q->first;
+        b = asked_bucket(request, win, atom);
+        q->next = *b;
+        *b = q;
+    }
+    if (!(a = calloc(1, sizeof(*a))))
+        err("can't allocate memory.");
+    a->data = data;
+    a->size = size;
+    *q->last = a;
+    q->last = &a->next;
+}
+
+/* reads the capture had no answer left for, and answers no read took */
+void model_unanswered(unsigned int *reads, unsigned int *answers) {
+    *reads = unanswered;
+    *answers = 0;
+    for (int i = 0; i < BUCKETS; i++)
+        for (const Asked *q = asked[i]; q; q = q->next)
+            for (const Answer *a = q->first; a; a = a->next)
+                (*answers)++;
+}
+
+/* requests sent, the NoOps stats.c marks with aside */
+unsigned int model_requests(void) {
+    return seq - noops;
+}
+
+void backend_create_window(xcb_window_t win, xcb_window_t parent,
+                           const xcb_rectangle_t *r, uint16_t border,
+                           uint16_t class, uint32_t mask,
+                           const uint32_t *values) {
+    (void)class;
+    (void)mask;
+    (void)values;
+    seq++;
+    add(win, parent, r)->border = border;
+}
+
+void backend_destroy(xcb_window_t win) {
+    seq++;
+    remove_window(win);
+}
+
+void backend_set_attributes(xcb_window_t win, uint32_t mask,
+                            const uint32_t *values) {
+    Win *w;
+
+    seq++;
+    /* values are in the order of their bits */
+    if ((w = find(win)) && (mask & XCB_CW_EVENT_MASK))
+        w->event_mask = values[__builtin_popcount(mask &
+                                                  (XCB_CW_EVENT_MASK - 1))];
+}
+
+void backend_configure(xcb_window_t win, uint16_t mask,
+                       const uint32_t *values) {
+    Win *w;
+    int i = 0;
+
+    seq++;
+    if (!(w = find(win)))
+        return;
+    if (mask & XCB_CONFIG_WINDOW_X)
+        w->geom.x = values[i++];
+    if (mask & XCB_CONFIG_WINDOW_Y)
+        w->geom.y = values[i++];
+    if (mask & XCB_CONFIG_WINDOW_WIDTH)
+        w->geom.width = values[i++];
+    if (mask & XCB_CONFIG_WINDOW_HEIGHT)
+        w->geom.height = values[i++];
+    if (mask & XCB_CONFIG_WINDOW_BORDER_WIDTH)
+        w->border = values[i++];
+}
+
+void backend_map(xcb_window_t win) {
+    Win *w;
+
+    seq++;
+    if ((w = find(win)))
+        w->mapped = true;
+}
+
+void backend_unmap(xcb_window_t win) {
+    Win *w;
+
+    seq++;
+    if ((w = find(win)))
+        w->mapped = false;
+}
+
+void backend_reparent(xcb_window_t win, xcb_window_t parent, int16_t x,
+                      int16_t y) {
+    Win *w;
+
+    seq++;
+    if (!(w = find(win)))
+        return;
+    w->parent = parent;
+    w->geom.x = x;
+    w->geom.y = y;
+}
+
+static void set_property(xcb_window_t win, uint8_t mode, xcb_atom_t prop,
+                         xcb_atom_t type, uint8_t format, uint32_t len,
+                         const void *data) {
+    const size_t unit = format / 8;
+    Win *w;
+    Prop *p;
+    uint8_t *d;
+
+    if (!(w = find(win)))
+        return;
+    if (!(p = find_prop(w, prop))) {
+        if (!(p = calloc(1, sizeof(*p))))
+            err("can't allocate memory.");
+        p->atom = prop;
+        p->next = w->props;
+        w->props = p;
+    } else if (mode == XCB_PROP_MODE_REPLACE || p->format != format) {
+        p->len = 0;
+    }
+    if (!(d = realloc(p->data, (p->len + len) * unit + 1)))
+        err("can't allocate memory.");
+    if (mode == XCB_PROP_MODE_PREPEND) {
+        memmove(d + len * unit, d, p->len * unit);
+        memcpy(d, data, len * unit);
+    } else {
+        memcpy(d + p->len * unit, data, len * unit);
+    }
+    p->data = d;
+    p->len += len;
+    p->type = type;
+    p->format = format;
+}
+
+/* a property as the client would have set it, before tfwm looks */
+void model_set_property(xcb_window_t win, xcb_atom_t prop, xcb_atom_t type,
+                        uint8_t format, uint32_t len, const void *data) {
+    set_property(win, XCB_PROP_MODE_REPLACE, prop, type, format, len, data);
+}
+
+void backend_set_property(xcb_window_t win, uint8_t mode, xcb_atom_t prop,
+                          xcb_atom_t type, uint8_t format, uint32_t len,
+                          const void *data) {
+    seq++;
+    set_property(win, mode, prop, type, format, len, data);
+}
+
+void backend_delete_property(xcb_window_t win, xcb_atom_t prop) {
+    Win *w;
+    Prop **pp, *p;
+
+    seq++;
+    if (!(w = find(win)))
+        return;
+    for (pp = &w->props; (p = *pp) && p->atom != prop; pp = &p->next)
+        ;
+    if (!p)
+        return;
+    *pp = p->next;
+    free(p->data);
+    free(p);
+}
+
+void backend_send_event(xcb_window_t win, uint32_t mask, const void *ev) {
+    (void)win;
+    (void)mask;
+    (void)ev;
+    seq++;
+}
+
+void backend_kill(xcb_window_t win) {
+    seq++;
+    remove_window(win);
+}
+
+void backend_allow_events(uint8_t mode, xcb_timestamp_t time) {
+    (void)mode;
+    (void)time;
+    seq++;
+}
+
+void backend_grab_key(uint16_t mod, xcb_keycode_t key) {
+    (void)mod;
+    (void)key;
+    seq++;
+    key_grabs++;
+}
+
+void backend_ungrab_keys(void) {
+    seq++;
+    key_grabs = 0;
+}
+
+void backend_grab_button(uint16_t mod, uint8_t button) {
+    (void)mod;
+    (void)button;
+    seq++;
+    button_grabs++;
+}
+
+void backend_ungrab_buttons(void) {
+    seq++;
+    button_grabs = 0;
+}
+
+bool backend_grab_pointer(uint16_t mask, xcb_cursor_t cursor) {
+    const xcb_grab_pointer_reply_t *r;
+    uint32_t size;
+
+    (void)mask;
+    (void)cursor;
+    seq++;
+    if (!replaying)
+        return true;
+    r = recall(XCB_GRAB_POINTER, XCB_NONE, XCB_NONE, &size);
+    return r && size >= sizeof(*r) && r->status == XCB_GRAB_STATUS_SUCCESS;
+}
+
+void backend_ungrab_pointer(void) {
+    seq++;
+}
+
+void backend_grabs(unsigned int *keys, unsigned int *buttons) {
+    *keys = key_grabs;
+    *buttons = button_grabs;
+}
+
+void backend_focus(xcb_window_t win) {
+    (void)win;
+    seq++;
+}
+
+/* win's position on the root */
+static void origin(xcb_window_t win, int16_t *x, int16_t *y) {
+    const Win *w;
+
+    *x = *y = 0;
+    for (; (w = find(win)) && w->parent != XCB_NONE; win = w->parent) {
+        *x += w->geom.x + w->border;
+        *y += w->geom.y + w->border;
+    }
+}
+
+void backend_warp(xcb_window_t win, int16_t x, int16_t y) {
+    int16_t ox, oy;
+
+    seq++;
+    origin(win, &ox, &oy);
+    pointer_x = ox + x;
+    pointer_y = oy + y;
+}
+
+xcb_window_t backend_new_id(void) {
+    xcb_window_t id;
+    const void *data;
+    uint32_t size;
+
+    if (replaying && (data = recall(CAPTURE_NEW_ID, XCB_NONE, XCB_NONE,
+                                    &size)) && size == sizeof(id)) {
+        memcpy(&id, data, sizeof(id));
+        return id;
+    }
+    return next_id++;
+}
+
+unsigned int backend_noop(void) {
+    noops++;
+    return ++seq;
+}
+
+void backend_flush(void) {
+}
+
+/* a drag in a replay gets the events it got when captured */
+xcb_generic_event_t *backend_wait_event(void) {
+    xcb_generic_event_t *ev;
+    const void *data;
+    uint32_t size;
+
+    if (!replaying ||
+        !(data = recall(CAPTURE_WAIT, XCB_NONE, XCB_NONE, &size)))
+        return NULL;
+    if (!(ev = calloc(1, sizeof(*ev))))
+        err("can't allocate memory.");
+    memcpy(ev, data, MIN(size, sizeof(*ev)));
+    return ev;
+}
+
+unsigned int backend_get_property(xcb_window_t win, xcb_atom_t prop,
+                                  xcb_atom_t type, uint32_t len) {
+    const Win *w;
+    const Prop *p;
+    xcb_get_property_reply_t *r;
+    size_t bytes = 0;
+
+    seq++;
+    if (replaying) {
+        replay_reply(XCB_GET_PROPERTY, win, prop);
+        return seq;
+    }
+    if (!(w = find(win)))
+        return seq;
+    p = find_prop(w, prop);
+    /* a type that doesn't match gets the actual one and no value */
+    if (p && (type == XCB_GET_PROPERTY_TYPE_ANY || type == p->type))
+        bytes = MIN((size_t)p->len * (p->format / 8), (size_t)len * 4);
+    r = answer(sizeof(*r) + bytes);
+    if (!p)
+        return seq;
+    r->format = p->format;
+    r->type = p->type;
+    r->value_len = bytes / (p->format / 8);
+    r->bytes_after = p->len * (p->format / 8) - bytes;
+    memcpy(r + 1, p->data, bytes);
+    return seq;
+}
+
+unsigned int backend_get_geometry(xcb_window_t win) {
+    const Win *w;
+    xcb_get_geometry_reply_t *r;
+
+    seq++;
+    if (replaying) {
+        replay_reply(XCB_GET_GEOMETRY, win, XCB_NONE);
+        return seq;
+    }
+    if (!(w = find(win)))
+        return seq;
+    r = answer(sizeof(*r));
+    r->depth = 24;
+    r->root = screen->root;
+    r->x = w->geom.x;
+    r->y = w->geom.y;
+    r->width = w->geom.width;
+    r->height = w->geom.height;
+    r->border_width = w->border;
+    return seq;
+}
+
+unsigned int backend_query_pointer(void) {
+    xcb_query_pointer_reply_t *r;
+
+    seq++;
+    if (replaying) {
+        replay_reply(XCB_QUERY_POINTER, XCB_NONE, XCB_NONE);
+        return seq;
+    }
+    r = answer(sizeof(*r));
+    r->same_screen = 1;
+    r->root = screen->root;
+    r->root_x = r->win_x = pointer_x;
+    r->root_y = r->win_y = pointer_y;
+    return seq;
+}
+
+/* no modifier has a key */
+unsigned int backend_get_modifier_mapping(void) {
+    seq++;
+    if (replaying)
+        replay_reply(XCB_GET_MODIFIER_MAPPING, XCB_NONE, XCB_NONE);
+    else
+        answer(sizeof(xcb_get_modifier_mapping_reply_t));
+    return seq;
+}
+
+void *backend_reply(unsigned int s) {
+    return take(s);
+}
+
+bool backend_poll(unsigned int s, void **reply) {
+    *reply = take(s);
+    return true;
+}
+
+void backend_discard(unsigned int s) {
+    free(take(s));
+}
+
+xcb_keycode_t *backend_keycodes(xcb_keysym_t sym) {
+    xcb_keycode_t *codes;
+    const void *data;
+    uint32_t size;
+    int i;
+
+    if (replaying &&
+        (data = recall(CAPTURE_KEYCODES, sym, XCB_NONE, &size))) {
+        if (!(codes = malloc(size)))
+            err("can't allocate memory.");
+        return memcpy(codes, data, size);
+    }
+    if (!(codes = calloc(2, sizeof(*codes))))
+        err("can't allocate memory.");
+    for (i = 0; i < nkeys && keymap[i] != sym; i++)
+        ;
+    if (i == nkeys && nkeys < LENGTH(keymap))
+        keymap[nkeys++] = sym;
+    if (i < nkeys)
+        codes[0] = 8 + i;
+    return codes;
+}
+
+xcb_keysym_t backend_keysym(xcb_keycode_t code) {
+    xcb_keysym_t sym;
+    const void *data;
+    uint32_t size;
+
+    if (replaying && (data = recall(CAPTURE_KEYSYM, code, XCB_NONE, &size)) &&
+        size == sizeof(sym)) {
+        memcpy(&sym, data, sizeof(sym));
+        return sym;
+    }
+    return code >= 8 && code - 8 < nkeys ? keymap[code - 8] : XCB_NO_SYMBOL;
+}
+
+void backend_refresh_keymap(xcb_mapping_notify_event_t *e) {
+    (void)e;
+}
+
+void backend_free_keymap(void) {
+    nkeys = 0;
+}
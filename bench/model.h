@@ -0,0 +1,21 @@
+/* See LICENSE file for copyright and license details. */
+#ifndef MODEL_H
+#define MODEL_H
+
+#include <xcb/xcb.h>
+
+/* bench/model.c: an X server kept in memory behind backend.h, and the
+ * globals main.c would have set up, for tfwm's modules to run without
+ * a server. model_replay() has it answer from a capture instead. */
+void model_setup(uint16_t width, uint16_t height);
+void model_teardown(void);
+xcb_window_t model_window(int16_t x, int16_t y, uint16_t w, uint16_t h);
+void model_set_property(xcb_window_t win, xcb_atom_t prop, xcb_atom_t type,
+                        uint8_t format, uint32_t len, const void *data);
+unsigned int model_requests(void);
+void model_replay(xcb_window_t root);
+void model_answer(uint8_t request, uint32_t win, uint32_t atom,
+                  const void *data, uint32_t size);
+void model_unanswered(unsigned int *reads, unsigned int *answers);
+
+#endif
@@ -0,0 +1,297 @@
+/* See LICENSE file for copyright and license details. */
+/* take tfwm through a session from a $TFWM_CAPTURE file again, as fast
+ * as its handlers go and with no server: all of tfwm but main.c,
+ * backend.c and launch.c is linked in, and bench/model.c answers each
+ * read with what the server answered when the session was captured.
+ * launch.c is left out so a key bound to a command starts nothing. */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../main.h"
+#include "../client.h"
+#include "../config.h"
+#include "../events.h"
+#include "../keys.h"
+#include "../launch.h"
+#include "../log.h"
+#include "../prop.h"
+#include "../stats.h"
+#include "../trace.h"
+#include "../workspace.h"
+#include "model.h"
+
+/* launch.c's part, short of starting anything: no launch ever waits
+ * for a window */
+static unsigned int commands;
+
+unsigned int launch_query(xcb_window_t win, LaunchQuery *q) {
+    (void)win;
+    q->sent = false;
+    return 0;
+}
+
+bool launch_match(xcb_window_t win, const LaunchQuery *q, unsigned int *ws) {
+    (void)win;
+    (void)q;
+    (void)ws;
+    return false;
+}
+
+void launch_focused(xcb_window_t win) {
+    (void)win;
+}
+
+void launch_dump(FILE *out, FILE *tsv) {
+    (void)out;
+    (void)tsv;
+}
+
+void launch_application(const Command *cmd) {
+    (void)cmd;
+    commands++;
+}
+
+void startup_event_cb(SnMonitorEvent *event, void *user_data) {
+    (void)event;
+    (void)user_data;
+}
+
+/* the session replayed, in the order it was captured. entries aren't
+ * aligned in the file, so each is copied out. */
+static struct {
+    struct capture_entry e;
+    const uint8_t *data;
+} *entries;
+static size_t nentries;
+static size_t session; /* the entry with the capture_session */
+
+/* what each read asked, by sequence number, for its answer */
+static struct {
+    uint8_t request;
+    uint32_t win, atom;
+} asks[1 << 16];
+
+/* time spent in each section over all rounds */
+static struct {
+    uint64_t ns, max;
+    unsigned int n;
+} sections[STAT_SECTIONS];
+
+static uint8_t *load(const char *file, size_t *len) {
+    uint8_t *buf = NULL;
+    size_t size = 0, n;
+    FILE *f;
+
+    if (!(f = fopen(file, "rb"))) {
+        perror(file);
+        return NULL;
+    }
+    *len = 0;
+    do {
+        if (*len == size) {
+            size = size ? size * 2 : 1 << 20;
+            if (!(buf = realloc(buf, size)))
+                err("can't allocate memory.");
+        }
+        n = fread(buf + *len, 1, size - *len, f);
+        *len += n;
+    } while (n > 0);
+    fclose(f);
+    return buf;
+}
+
+/* the entries of the nth session in the file, from 1. one cut short, as
+ * by a crash, ends where it was cut. */
+static bool parse(const uint8_t *buf, size_t len, int nth) {
+    struct trace_header h;
+    struct capture_entry e;
+    size_t off = 0, size = 0;
+    int at = 0;
+
+    while (off < len) {
+        if (len - off >= sizeof(h) &&
+            memcmp(buf + off, CAPTURE_MAGIC, sizeof(h.magic)) == 0) {
+            memcpy(&h, buf + off, sizeof(h));
+            if (h.size != sizeof(e))
+                return false;
+            off += sizeof(h);
+            at++;
+            continue;
+        }
+        if (at == 0 || len - off < sizeof(e))
+            break;
+        memcpy(&e, buf + off, sizeof(e));
+        off += sizeof(e);
+        if (e.size > len - off)
+            break;
+        if (at == nth) {
+            if (nentries == size) {
+                size = size ? size * 2 : 4096;
+                if (!(entries = realloc(entries, size * sizeof(*entries))))
+                    err("can't allocate memory.");
+            }
+            entries[nentries].e = e;
+            entries[nentries++].data = buf + off;
+        }
+        off += e.size;
+    }
+    for (session = 0; session < nentries; session++)
+        if (entries[session].e.kind == CAPTURE_SESSION)
+            return true;
+    return false;
+}
+
+/* the model, set up as tfwm found the server, with every answer the
+ * session got waiting for its read */
+static bool start(void) {
+    const uint8_t *data = entries[session].data;
+    const uint32_t size = entries[session].e.size;
+    struct capture_session s;
+    const size_t from = offsetof(xcb_ewmh_connection_t, _NET_SUPPORTED);
+    const size_t natoms = (sizeof(*ewmh) - from) / sizeof(xcb_atom_t);
+
+    if (size < sizeof(s))
+        return false;
+    memcpy(&s, data, sizeof(s));
+    if (s.natoms != natoms || size != sizeof(s) + natoms * 4) {
+        fprintf(stderr, "replay: captured with another xcb-ewmh\n");
+        return false;
+    }
+    model_setup(s.width, s.height);
+    model_replay(s.root);
+    memcpy((uint8_t *)ewmh + from, data + sizeof(s), natoms * 4);
+    WM_DELETE_WINDOW = s.wm_delete_window;
+    WM_TAKE_FOCUS = s.wm_take_focus;
+    WM_PROTOCOLS = s.wm_protocols;
+    NET_STARTUP_ID = s.net_startup_id;
+    WM_WINDOW_ROLE = s.wm_window_role;
+    numlockmask = s.numlockmask;
+    focus_pixel = s.focus_pixel;
+    unfocus_pixel = s.unfocus_pixel;
+    prop_setup();
+
+    for (size_t i = 0; i < nentries; i++) {
+        const struct capture_entry *e = &entries[i].e;
+
+        if (e->kind == CAPTURE_ASK) {
+            asks[e->seq].request = e->request;
+            asks[e->seq].win = e->window;
+            asks[e->seq].atom = e->atom;
+        } else if (e->kind == CAPTURE_ANSWER && e->request == 0) {
+            model_answer(asks[e->seq].request, asks[e->seq].win,
+                         asks[e->seq].atom, entries[i].data, e->size);
+        } else if (e->kind == CAPTURE_ANSWER) {
+            model_answer(e->request, e->window, XCB_NONE, entries[i].data,
+                         e->size);
+        }
+    }
+    return true;
+}
+
+static void account(int section, uint64_t ns) {
+    sections[section].ns += ns;
+    sections[section].n++;
+    if (ns > sections[section].max)
+        sections[section].max = ns;
+}
+
+/* what run() and the end of setup() did, in the order they did it.
+ * returns the ns it took. */
+static uint64_t replay(void) {
+    const uint64_t begin = stats_now();
+    xcb_generic_event_t ev;
+    uint64_t start;
+    uint8_t type;
+
+    for (size_t i = 0; i < nentries; i++) {
+        const struct capture_entry *e = &entries[i].e;
+
+        switch (e->kind) {
+        case CAPTURE_MANAGE:
+            start = stats_now();
+            manage(e->window);
+            account(STAT_MANAGE, stats_now() - start);
+            break;
+        case CAPTURE_READY:
+            focus(NULL);
+            break;
+        case CAPTURE_EVENT:
+            memset(&ev, 0, sizeof(ev));
+            memcpy(&ev, entries[i].data, MIN(e->size, sizeof(ev)));
+            type = ev.response_type & ~0x80;
+            start = stats_now();
+            handleevent(&ev);
+            account(type < STAT_OTHER ? type : STAT_OTHER,
+                    stats_now() - start);
+            break;
+        case CAPTURE_DRAINED:
+            start = stats_now();
+            handlepending();
+            account(STAT_PENDING, stats_now() - start);
+            break;
+        }
+    }
+    return stats_now() - begin;
+}
+
+static void finish(unsigned int *reads, unsigned int *answers) {
+    while (clients)
+        unmanage(clients);
+    handlepending();
+    model_unanswered(reads, answers);
+    prop_teardown();
+    model_teardown();
+    selws = 0;
+    sel = NULL;
+}
+
+int main(int argc, char **argv) {
+    unsigned int events = 0, reads, answers;
+    uint64_t best = UINT64_MAX, ns;
+    const int nth = argc > 2 ? atoi(argv[2]) : 1;
+    const int rounds = argc > 3 ? atoi(argv[3]) : 5;
+    uint8_t *buf;
+    size_t len;
+
+    if (argc < 2 || argc > 4 || nth < 1 || rounds < 1) {
+        fprintf(stderr, "usage: %s capture [session [rounds]]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (!(buf = load(argv[1], &len)))
+        return EXIT_FAILURE;
+    if (!parse(buf, len, nth)) {
+        fprintf(stderr, "%s: no session %d from this version\n", argv[1],
+                nth);
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < nentries; i++)
+        events += entries[i].e.kind == CAPTURE_EVENT;
+
+    for (int r = 0; r < rounds; r++) {
+        if (!start())
+            return EXIT_FAILURE;
+        if ((ns = replay()) < best)
+            best = ns;
+        finish(&reads, &answers);
+    }
+
+    printf("session %d: %u events, best of %d rounds %.3f ms, %.0f "
+           "events/s\n",
+           nth, events, rounds, best / 1e6, events / (best / 1e9));
+    printf("%-24s %10s %12s %12s\n", "section", "count", "mean us",
+           "max us");
+    for (int i = 0; i < STAT_SECTIONS; i++)
+        if (sections[i].n)
+            printf("%-24s %10u %12.2f %12.2f\n", stats_section_name(i),
+                   sections[i].n / rounds,
+                   sections[i].ns / 1e3 / sections[i].n,
+                   sections[i].max / 1e3);
+    /* where the replay went another way than the session did */
+    printf("reads unanswered %u, answers left %u, commands not run %u\n",
+           reads, answers, commands / rounds);
+
+    free(entries);
+    free(buf);
+    return EXIT_SUCCESS;
+}
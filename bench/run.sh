@@ -0,0 +1,88 @@
+#!/bin/sh
+# run tfwm on a private Xvfb and drive it with tfwm-bench:
+#   bench/run.sh [bench[:n]...]
+# the stats files it leaves are in $XDG_RUNTIME_DIR, printed at the end,
+# with every figure as a json line in bench.json. the session is
+# captured, and replayed at the end with tfwm-replay.
+cd "$(dirname "$0")/.." || exit 1
+
+# a skip is fine at a desk, but in CI it would pass without checking
+if ! command -v Xvfb >/dev/null 2>&1; then
+    if [ -n "$CI" ]; then
+        echo "bench: Xvfb not found, can't run the X benchmarks" >&2
+        exit 1
+    fi
+    echo "bench: Xvfb not found, skipping the X benchmarks"
+    exit 0
+fi
+
+dir=$(mktemp -d)
+display=:${BENCH_DISPLAY:-99}
+export DISPLAY=$display XDG_RUNTIME_DIR=$dir XDG_CACHE_HOME=$dir HOME=$dir
+export BENCH_JSON=$dir/bench.json
+
+Xvfb "$display" -screen 0 1920x1080x24 -nolisten tcp 2>"$dir/xvfb.log" &
+xvfb=$!
+trap 'kill $wm $xvfb 2>/dev/null; wait' EXIT
+sleep 1
+# F2 spawns amixer: let the spawn bench run true in its place
+mkdir "$dir/bin" && ln -s "$(command -v true)" "$dir/bin/amixer" || exit 1
+export TFWM_BENCH_BIN=$dir/bin
+PATH=$dir/bin:$PATH TFWM_CAPTURE=$dir/capture ./tfwm 2>"$dir/tfwm.log" &
+wm=$!
+bench/tfwm-bench wait || exit 1
+
+rc=0
+soak=0
+for b in ${*:-spawn props budget scale input soak}; do
+    # scale appends resources rows of its own: soak's come after these
+    [ "${b%%:*}" = soak ] && soak=$(cat "$dir/tfwm-resources.tsv" \
+        2>/dev/null | wc -l)
+    bench/tfwm-bench "${b%%:*}" $(echo "$b" | sed -n 's/.*://p') || rc=1
+done
+
+sleep 1
+kill -USR1 $wm
+sleep 1
+cat "$dir/tfwm-events.tsv"
+
+# the same session through the handlers again, with no server
+kill $wm
+wait $wm
+bench/tfwm-replay "$dir/capture" 1 3 || rc=1
+
+# sections over their round trip budget
+awk -F '\t' 'NR > 1 && $10 != "" && $9 > $10 {
+    printf "bench: %s took %d round trips, budget %d\n", $1, $9, $10
+    over = 1
+} END { exit over }' "$dir/tfwm-events.tsv" || rc=1
+
+# growth between the first resources row from the soak and the last,
+# taken once everything has closed: nothing may still be managed, grabs
+# and cursors stay put, and rss may only move a little
+awk -F '\t' -v first=$((soak > 0 ? soak + 1 : 2)) '
+NR == first { keys = $7; buttons = $8; cursors = $9; rss = $2 }
+NR > first { last = $0 }
+END {
+    if (NR <= first)
+        exit 0
+    split(last, f, "\t")
+    if (f[4] != 0 || f[5] != 0 || f[6] != 0) {
+        printf "bench: %d clients, %d frames, %d bytes left\n", f[4], f[5],
+               f[6]
+        over = 1
+    }
+    if (f[7] != keys || f[8] != buttons || f[9] != cursors) {
+        printf "bench: grabs or cursors went from %d/%d/%d to %d/%d/%d\n",
+               keys, buttons, cursors, f[7], f[8], f[9]
+        over = 1
+    }
+    if (f[2] - rss > 1024) {
+        printf "bench: rss grew %d kB\n", f[2] - rss
+        over = 1
+    }
+    exit over
+}' "$dir/tfwm-resources.tsv" || rc=1
+
+echo "bench: stats in $dir"
+exit $rc
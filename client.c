@@ -2,6 +2,7 @@
 #include <string.h>
 #include <xcb/xcb_icccm.h>
 #include "main.h"
+#include "backend.h"
 #include "list.h"
 #include "client.h"
 #include "keys.h"
@@ -9,28 +10,111 @@
 #include "xcb.h"
 #include "config.h"
 #include "cursor.h"
+#include "geom.h"
 #include "workspace.h"
 #include "launch.h"
+#include "memo.h"
+#include "place.h"
+#include "prop.h"
+#include "stats.h"
+#include "trace.h"
 #include "log.h"
 
 void applyrules(Client *c) {
-    ewmh_get_wm_window_type(c);
-    ewmh_get_wm_state(c);
-
     /* custom rules */
-    xcb_icccm_get_wm_class_reply_t reply;
-    if (!xcb_icccm_get_wm_class_reply(
-            conn, xcb_icccm_get_wm_class(conn, c->win), &reply, NULL))
+    prop_fetch(c, PROP_CLASS);
+    if (!c->class.class_name)
         return;
 
     for (int i = 0; i < LENGTH(rules); i++) {
         const Rule *rule = &rules[i];
-        if ((rule->class && strstr(reply.class_name, rule->class))) {
+        if ((rule->class && strstr(c->class.class_name, rule->class))) {
             if (!rule->border)
                 c->noborder = true;
         }
     }
-    xcb_icccm_get_wm_class_reply_wipe(&reply);
+}
+
+/* resolve WM_NORMAL_HINTS into the form applysizehints() uses */
+void setsizehints(Client *c, const xcb_size_hints_t *sh) {
+    SizeHints *h = &c->size_hints;
+
+    memset(h, 0, sizeof(*h));
+    h->win_gravity = XCB_GRAVITY_NORTH_WEST;
+
+    /* base and min size default to each other */
+    if (sh->flags & XCB_ICCCM_SIZE_HINT_BASE_SIZE) {
+        h->base_width = h->min_width = MAX(sh->base_width, 0);
+        h->base_height = h->min_height = MAX(sh->base_height, 0);
+    }
+    if (sh->flags & XCB_ICCCM_SIZE_HINT_P_MIN_SIZE) {
+        h->min_width = MAX(sh->min_width, 0);
+        h->min_height = MAX(sh->min_height, 0);
+        if (!(sh->flags & XCB_ICCCM_SIZE_HINT_BASE_SIZE)) {
+            h->base_width = h->min_width;
+            h->base_height = h->min_height;
+        }
+    }
+    if (sh->flags & XCB_ICCCM_SIZE_HINT_P_MAX_SIZE) {
+        if (sh->max_width > 0)
+            h->max_width = MAX(sh->max_width, h->min_width);
+        if (sh->max_height > 0)
+            h->max_height = MAX(sh->max_height, h->min_height);
+    }
+    if (sh->flags & XCB_ICCCM_SIZE_HINT_P_RESIZE_INC) {
+        h->width_inc = MAX(sh->width_inc, 0);
+        h->height_inc = MAX(sh->height_inc, 0);
+    }
+    if (sh->flags & XCB_ICCCM_SIZE_HINT_P_ASPECT && sh->min_aspect_num > 0 &&
+        sh->min_aspect_den > 0 && sh->max_aspect_num > 0 &&
+        sh->max_aspect_den > 0) {
+        h->min_aspect_num = sh->min_aspect_num;
+        h->min_aspect_den = sh->min_aspect_den;
+        h->max_aspect_num = sh->max_aspect_num;
+        h->max_aspect_den = sh->max_aspect_den;
+    }
+    if (sh->flags & XCB_ICCCM_SIZE_HINT_P_WIN_GRAVITY)
+        h->win_gravity = sh->win_gravity;
+}
+
+/* ICCCM 4.1.2.3: the one place a client size is checked against its hints.
+ * w and h are the client size without the border. */
+void applysizehints(Client *c, int32_t *w, int32_t *h) {
+    const SizeHints *sh = &c->size_hints;
+
+    prop_fetch(c, PROP_NORMAL_HINTS);
+
+    /* aspect limits apply to the size less the base size */
+    if (sh->min_aspect_den > 0) {
+        int32_t aw = *w - sh->base_width;
+        int32_t ah = *h - sh->base_height;
+        if (aw > 0 && ah > 0) {
+            if ((int64_t)aw * sh->max_aspect_den >
+                (int64_t)ah * sh->max_aspect_num)
+                aw = (int64_t)ah * sh->max_aspect_num / sh->max_aspect_den;
+            else if ((int64_t)aw * sh->min_aspect_den <
+                     (int64_t)ah * sh->min_aspect_num)
+                ah = (int64_t)aw * sh->min_aspect_den / sh->min_aspect_num;
+            *w = aw + sh->base_width;
+            *h = ah + sh->base_height;
+        }
+    }
+
+    if (sh->width_inc > 0 && *w > sh->base_width)
+        *w -= (*w - sh->base_width) % sh->width_inc;
+    if (sh->height_inc > 0 && *h > sh->base_height)
+        *h -= (*h - sh->base_height) % sh->height_inc;
+
+    *w = MAX(*w, sh->min_width);
+    *h = MAX(*h, sh->min_height);
+    if (sh->max_width > 0)
+        *w = MIN(*w, sh->max_width);
+    if (sh->max_height > 0)
+        *h = MIN(*h, sh->max_height);
+
+    /* X rejects zero sized windows */
+    *w = MAX(*w, 1);
+    *h = MAX(*h, 1);
 }
 
 void cycleclients(const Arg *arg) {
@@ -40,29 +124,126 @@ void cycleclients(const Arg *arg) {
         focusstack(false);
 }
 
-void fit_in_screen(Client *c) {
-    bool update = false;
+/* the size c needs to fit on screen. false if it already does. */
+static bool fit_size(Client *c, int32_t *w, int32_t *h) {
+    *w = c->geom.width;
+    *h = c->geom.height;
 
     if (c->noborder)
+        return false;
+
+    if (*w >= screen->width_in_pixels - 2 * border_width)
+        *w = screen->width_in_pixels - 2 * border_width;
+    if (*h >= screen->height_in_pixels - 2 * border_width)
+        *h = screen->height_in_pixels - 2 * border_width;
+
+    if (*w == c->geom.width && *h == c->geom.height)
+        return false;
+
+    applysizehints(c, w, h);
+    return true;
+}
+
+void focusdir(const Arg *arg) {
+    Client *c;
+
+    if (!sel || !(c = geom_neighbor(sel, arg->i)))
         return;
+    focus(c);
+    raiseclient(sel);
+}
 
-    if (c->geom.width >= screen->width_in_pixels - 2 * border_width) {
-        update = true;
-        c->geom.width = screen->width_in_pixels - 2 * border_width;
-    }
+/* trade places, and sizes as far as each one's hints allow, with the
+ * window next to sel. focus stays with sel. */
+void swapdir(const Arg *arg) {
+    Client *c;
+    xcb_rectangle_t a, b;
+    int32_t w, h;
+
+    if (!sel || ISFULLSCREEN(sel) || !(c = geom_neighbor(sel, arg->i)) ||
+        ISFULLSCREEN(c))
+        return;
 
-    if (c->geom.height >= screen->height_in_pixels - 2 * border_width) {
-        update = true;
-        c->geom.height = screen->height_in_pixels - 2 * border_width;
+    a = sel->geom;
+    b = c->geom;
+    w = b.width;
+    h = b.height;
+    applysizehints(sel, &w, &h);
+    moveresize_client(sel, b.x, b.y, w, h);
+    w = a.width;
+    h = a.height;
+    applysizehints(c, &w, &h);
+    moveresize_client(c, a.x, a.y, w, h);
+    raiseclient(sel);
+    warp_pointer(sel);
+}
+
+/* the root changed size: one pass brings every frame back on screen.
+ * sizes are fixed first, then positions clamped, so a client only
+ * moves as far as it has to. hidden frames stay where they are and get
+ * their new place when their workspace is shown. */
+void fit_all_in_screen(void) {
+    const int32_t sw = screen->width_in_pixels;
+    const int32_t sh = screen->height_in_pixels;
+    int32_t w, h, x, y;
+    Client **misfits;
+    uint32_t n;
+
+    /* the few that need it, picked out of the geometry store a vector
+     * at a time */
+    if (!(misfits = malloc((geom_count() + 1) * sizeof(*misfits))))
+        err("can't allocate memory.");
+    n = geom_misfits(sw, sh, misfits);
+    for (uint32_t i = 0; i < n; i++) {
+        Client *c = misfits[i];
+        if (!fit_size(c, &w, &h)) {
+            w = c->geom.width;
+            h = c->geom.height;
+        }
+        /* the borders, on top of the new size */
+        x = MAX(0, MIN(c->geom.x, sw - (w + BWIDTH(c) - c->geom.width)));
+        y = MAX(0, MIN(c->geom.y, sh - (h + BHEIGHT(c) - c->geom.height)));
+        if (x == c->geom.x && y == c->geom.y && w == c->geom.width &&
+            h == c->geom.height)
+            continue;
+
+        PRINTF("fit_all_in_screen: win %#x to (%d,%d) %dx%d\n", c->win, x,
+               y, w, h);
+        if (ISVISIBLE(c)) {
+            moveresize_client(c, x, y, w, h);
+        } else {
+            c->geom.x = x;
+            c->geom.y = y;
+            c->geom.width = w;
+            c->geom.height = h;
+            geom_update(c);
+            resizewin(c->frame, w, h);
+            resizewin(c->win, w, h);
+        }
     }
+    FREE(misfits);
+}
 
-    if (update) {
-        PRINTF("fit_in_screen: resize win %#x to (%d,%d) %dx%d\n", c->win,
-               c->geom.x, c->geom.y, c->geom.width, c->geom.height);
+/* settle a new client's geometry before it has a frame, so the frame is
+ * created where it stays and nothing moves after the first map. a
+ * remembered geometry is kept, as far as the screen allows. */
+static void place(Client *c, bool remembered) {
+    int32_t w, h;
 
+    if (fit_size(c, &w, &h)) {
+        PRINTF("place: resize win %#x to (0,0) %dx%d\n", c->win, w, h);
         c->geom.x = c->geom.y = 0;
-        moveresize_win(c->frame, c->geom.x, c->geom.y, c->geom.width,
-                       c->geom.height);
+        c->geom.width = w;
+        c->geom.height = h;
+        resizewin(c->win, w, h);
+    } else if (remembered) {
+        c->geom.x = MAX(0, MIN(c->geom.x,
+                               screen->width_in_pixels - BWIDTH(c)));
+        c->geom.y = MAX(0, MIN(c->geom.y,
+                               screen->height_in_pixels - BHEIGHT(c)));
+        resizewin(c->win, c->geom.width, c->geom.height);
+    } else {
+        place_client(c);
     }
 }
 
@@ -71,23 +252,83 @@ void killselected(const Arg *arg) {
     if (!sel)
         return;
 
+    prop_fetch(sel, PROP_PROTOCOLS);
     if (sel->can_delete)
         send_client_message(sel, WM_DELETE_WINDOW);
     else
-        xcb_kill_client(conn, sel->win);
+        backend_kill(sel->win);
+}
+
+/* the lowest of the unframed windows kept above the frames, the first of
+ * them mapped. frames are raised to just under it. */
+static xcb_window_t layer_floor;
+
+/* docks, notifications and popups go on top, the desktop at the bottom */
+static bool above_frames(const Client *c) {
+    return ISUNFRAMED(c) && c->type != WINTYPE_DESKTOP;
+}
+
+/* raise a frame, but under the docks and notifications */
+static void raiseframe(xcb_window_t frame) {
+    if (layer_floor)
+        backend_configure(frame,
+                          XCB_CONFIG_WINDOW_SIBLING |
+                              XCB_CONFIG_WINDOW_STACK_MODE,
+                          (uint32_t[]){layer_floor, XCB_STACK_MODE_BELOW});
+    else
+        raisewindow(frame);
+}
+
+/* docks, desktops, notifications and popups are mapped as they are: no frame,
+ * no focus, and no place in the focus stack, so workspace switches leave them
+ * alone. */
+static void manage_unframed(Client *c) {
+    const uint32_t values[] = {c->type == WINTYPE_DESKTOP
+                                   ? XCB_STACK_MODE_BELOW
+                                   : XCB_STACK_MODE_ABOVE};
+
+    PRINTF("manage: win %#x is unframed (type %d)\n", c->win, c->type);
+    attach(c);
+    backend_configure(c->win, XCB_CONFIG_WINDOW_STACK_MODE, values);
+    if (above_frames(c) && !layer_floor)
+        layer_floor = c->win;
+    backend_map(c->win);
+    ewmh_add_client(c);
 }
 
 void manage(xcb_window_t w) {
     PRINTF("manage: manage window %#x\n", w);
 
-    Client *c;
-    if (!(c = malloc(sizeof(Client))))
-        err("can't allocate memory.");
+    Client *c = client_alloc();
     c->win = w;
 
-    /* get geometry */
-    xcb_get_geometry_reply_t *gr =
-        xcb_get_geometry_reply(conn, xcb_get_geometry(conn, w), NULL);
+    /* all manage asks the server in one round trip: geometry, type and
+     * state; the cached properties, watched from here on so no change is
+     * lost between this and the reply; what the launch match needs; and
+     * the pointer, for placement under it */
+    const unsigned int gc = backend_get_geometry(w);
+    const unsigned int tc = backend_get_property(w, ewmh->_NET_WM_WINDOW_TYPE,
+                                                 XCB_ATOM_ATOM, UINT32_MAX);
+    const unsigned int sc = backend_get_property(w, ewmh->_NET_WM_STATE,
+                                                 XCB_ATOM_ATOM, UINT32_MAX);
+    unsigned int last = sc, seq;
+    LaunchQuery lq;
+
+    backend_set_attributes(w, XCB_CW_EVENT_MASK,
+                           (uint32_t[]){XCB_EVENT_MASK_PROPERTY_CHANGE});
+    /* the role is only for the geometry memory */
+    uint8_t props = PROP_ALL;
+    if (!remember_geometry)
+        props &= ~PROP_ROLE;
+    c->valid_props = c->fetching_props = 0;
+    if ((seq = prop_prefetch(c, props)))
+        last = seq;
+    if ((seq = launch_query(w, &lq)))
+        last = seq;
+    if ((seq = place_prefetch()))
+        last = seq;
+    stats_wait(last);
+    xcb_get_geometry_reply_t *gr = backend_reply(gc);
 
     if (gr) {
         c->geom.x = c->old_geom.x = gr->x;
@@ -109,35 +350,34 @@ void manage(xcb_window_t w) {
         warn("xcb_get_geometry failed for win %#x.", w);
     }
 
-    c->size_hints.flags = 0;
-    c->size_hints.x = c->size_hints.y = 0;
-    c->size_hints.width = c->size_hints.height = 0;
-    c->size_hints.min_width = c->size_hints.min_height = 0;
-    c->size_hints.max_width = c->size_hints.max_height = 0;
-    c->size_hints.width_inc = c->size_hints.height_inc = 0;
-    c->size_hints.min_aspect_num = c->size_hints.min_aspect_den = 0;
-    c->size_hints.max_aspect_num = c->size_hints.max_aspect_den = 0;
-    c->size_hints.base_width = c->size_hints.base_height = 0;
-    c->size_hints.win_gravity = 0;
+    memset(&c->size_hints, 0, sizeof(c->size_hints));
+    memset(&c->class, 0, sizeof(c->class));
+    c->role = NULL;
+    c->wm_hints = 0;
     c->can_focus = c->can_delete = c->noborder = false;
     c->frame = XCB_NONE;
+    c->next = c->snext = NULL;
     c->ewmh_flags = 0;
+    c->type = WINTYPE_NORMAL;
     c->ws = selws;
     c->ignore_unmap = 0;
 
-    /* get size hints */
-    xcb_icccm_get_wm_normal_hints_reply(
-        conn, xcb_icccm_get_wm_normal_hints(conn, c->win), &c->size_hints,
-        NULL);
+    unsigned int ws;
+    const bool launched = launch_match(c->win, &lq, &ws);
+
+    ewmh_get_wm_window_type(c, tc);
+    if (ISUNFRAMED(c)) {
+        backend_discard(sc);
+        place_discard();
+        prop_wipe(c);
+        backend_set_attributes(w, XCB_CW_EVENT_MASK,
+                               (uint32_t[]){XCB_EVENT_MASK_NO_EVENT});
+        manage_unframed(c);
+        return;
+    }
+
+    prop_fetch(c, props);
 #if DEBUG
-    if (c->size_hints.x)
-        PRINTF(" x: %d\n", c->size_hints.x);
-    if (c->size_hints.y)
-        PRINTF(" y: %d\n", c->size_hints.y);
-    if (c->size_hints.width)
-        PRINTF(" width: %d\n", c->size_hints.width);
-    if (c->size_hints.height)
-        PRINTF(" height: %d\n", c->size_hints.height);
     if (c->size_hints.min_height)
         PRINTF(" min height: %d\n", c->size_hints.min_height);
     if (c->size_hints.min_width)
@@ -150,53 +390,33 @@ void manage(xcb_window_t w) {
         PRINTF(" base height: %d\n", c->size_hints.base_height);
     if (c->size_hints.base_width)
         PRINTF(" base width: %d\n", c->size_hints.base_width);
+    if (c->size_hints.width_inc)
+        PRINTF(" width inc: %d\n", c->size_hints.width_inc);
+    if (c->size_hints.height_inc)
+        PRINTF(" height inc: %d\n", c->size_hints.height_inc);
 #endif
 
-    /* get wm hints */
-    xcb_icccm_wm_hints_t wmh;
-    xcb_icccm_get_wm_hints_reply(conn, xcb_icccm_get_wm_hints(conn, c->win),
-                                 &wmh, NULL);
-    c->wm_hints = wmh.flags;
-
-    if (c->wm_hints & XCB_ICCCM_WM_HINT_X_URGENCY) {
-        PRINTF("ICCCM: Urgent win %#x\n", c->win);
-    }
-
-    /* get protocols */
-    xcb_icccm_get_wm_protocols_reply_t pr;
-    if (xcb_icccm_get_wm_protocols_reply(
-            conn, xcb_icccm_get_wm_protocols(conn, c->win, WM_PROTOCOLS), &pr,
-            NULL) == 1) {
-        for (unsigned int i = 0; i < pr.atoms_len; ++i) {
-            if (pr.atoms[i] == WM_DELETE_WINDOW)
-                c->can_delete = true;
-            if (pr.atoms[i] == WM_TAKE_FOCUS)
-                c->can_focus = true;
-        }
-        xcb_icccm_get_wm_protocols_reply_wipe(&pr);
-    }
-
+    ewmh_get_wm_state(c, sc);
     applyrules(c);
+    bool remembered = memo_apply(c);
 
-    if (center_new_windows) {
-        c->geom.x = (screen->width_in_pixels - BWIDTH(c)) / 2;
-        c->geom.y = (screen->height_in_pixels - BHEIGHT(c)) / 2;
-        PRINTF("manage: centering to (%d,%d)\n", c->geom.x, c->geom.y);
-        movewin(c->win, c->geom.x, c->geom.y);
-        warp_pointer(c);
-    }
+    /* windows we launched go where they were launched from */
+    if (launched)
+        c->ws = ws;
 
+    place(c, remembered);
+    place_discard();
     reparent(c);
     attach(c);
     attachstack(c);
+    geom_add(c);
     sel = c;
-    fit_in_screen(c);
 
-    if (c->ws == selws)
-        xcb_map_window(conn, w);
+    backend_map(w);
 
-    warp_pointer(c);
-    ewmh_update_client_list(clients);
+    if (ISVISIBLE(c))
+        warp_pointer(c);
+    ewmh_add_client(c);
     focus(NULL);
 }
 
@@ -206,12 +426,11 @@ void reparent(Client *c) {
     uint16_t width = c->geom.width;
     uint16_t height = c->geom.height;
 #if DEBUG
-    if (c->size_hints.flags & XCB_ICCCM_SIZE_HINT_P_WIN_GRAVITY &&
-        c->size_hints.win_gravity > 1)
+    if (c->size_hints.win_gravity > XCB_GRAVITY_NORTH_WEST)
         PRINTF("reparent: NONSTANDARD GRAVITY: %d\n",
                c->size_hints.win_gravity);
 #endif
-    c->frame = xcb_generate_id(conn);
+    c->frame = backend_new_id();
     uint32_t mask =
         XCB_CW_BORDER_PIXEL | XCB_CW_OVERRIDE_REDIRECT | XCB_CW_EVENT_MASK;
     uint32_t vals[3];
@@ -220,20 +439,28 @@ void reparent(Client *c) {
     vals[2] = XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY |
               XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT;
 
+    if (!ISVISIBLE(c))
+        x = HIDDEN_X(c);
+
     PRINTF("reparent: creating frame (%d,%d) %dx%d\n", x, y, width, height);
-    xcb_create_window(conn, XCB_COPY_FROM_PARENT, c->frame, screen->root, x, y,
-                      width, height, c->noborder ? 0 : border_width,
-                      XCB_WINDOW_CLASS_INPUT_OUTPUT, XCB_COPY_FROM_PARENT, mask,
-                      vals);
-
-    xcb_configure_window(conn, c->frame,
-                         XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT,
-                         (uint32_t[]){c->geom.width, c->geom.height});
+    backend_create_window(c->frame, screen->root,
+                          &(xcb_rectangle_t){x, y, width, height},
+                          c->noborder ? 0 : border_width,
+                          XCB_WINDOW_CLASS_INPUT_OUTPUT, mask, vals);
+
+    backend_configure(c->frame,
+                      XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT,
+                      (uint32_t[]){c->geom.width, c->geom.height});
+    /* a new window goes on top, which is under the docks */
+    if (layer_floor)
+        raiseframe(c->frame);
     c->ignore_unmap++;
-    xcb_map_window(conn, c->frame);
+    backend_map(c->frame);
 
+    /* the frame draws the border */
+    setborderwidth(c->win, 0);
     PRINTF("reparent: reparenting win %#x to %#x\n", c->win, c->frame);
-    xcb_reparent_window(conn, c->win, c->frame, 0, 0);
+    backend_reparent(c->win, c->frame, 0, 0);
 }
 
 void maximize(const Arg *arg) {
@@ -250,7 +477,8 @@ void maximizeaxis(const Arg *arg) {
 }
 
 void maximizeaxis_client(Client *c, uint16_t direction) {
-    uint32_t values[3];
+    int32_t w = c->geom.width;
+    int32_t h = c->geom.height;
 
     if ((ISMAXVERT(c) && direction == MaxVertical) ||
         (ISMAXHORZ(c) && direction == MaxHorizontal)) {
@@ -261,32 +489,16 @@ void maximizeaxis_client(Client *c, uint16_t direction) {
     savegeometry(c);
 
     if (direction == MaxVertical) {
-        c->geom.y = 0;
-        c->geom.height = c->noborder
-                             ? screen->height_in_pixels
-                             : screen->height_in_pixels - border_width * 2;
-        values[0] = c->geom.y;
-        values[1] = c->geom.height;
-        xcb_configure_window(conn, c->frame,
-                             XCB_CONFIG_WINDOW_Y | XCB_CONFIG_WINDOW_HEIGHT,
-                             values);
-        xcb_configure_window(conn, c->win,
-                             XCB_CONFIG_WINDOW_Y | XCB_CONFIG_WINDOW_HEIGHT,
-                             values);
+        h = c->noborder ? screen->height_in_pixels
+                        : screen->height_in_pixels - border_width * 2;
+        applysizehints(c, &w, &h);
+        moveresize_client(c, c->geom.x, 0, w, h);
         change_ewmh_flags(c, XCB_EWMH_WM_STATE_ADD, EWMH_MAXIMIZED_VERT);
     } else { /* horizontal */
-        c->geom.x = 0;
-        c->geom.width = c->noborder
-                            ? screen->width_in_pixels
-                            : screen->width_in_pixels - border_width * 2;
-        values[0] = c->geom.x;
-        values[1] = c->geom.width;
-        xcb_configure_window(conn, c->frame,
-                             XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_WIDTH,
-                             values);
-        xcb_configure_window(conn, c->win,
-                             XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_WIDTH,
-                             values);
+        w = c->noborder ? screen->width_in_pixels
+                        : screen->width_in_pixels - border_width * 2;
+        applysizehints(c, &w, &h);
+        moveresize_client(c, 0, c->geom.y, w, h);
         change_ewmh_flags(c, XCB_EWMH_WM_STATE_ADD, EWMH_MAXIMIZED_HORZ);
     }
 
@@ -304,6 +516,7 @@ void maximizeclient(Client *c, bool doit) {
     }
     PRINTF("maximizeclient: %s to ", doit ? "maximizing" : "unmaximizing");
 
+    /* fullscreen ignores size hints, as EWMH asks */
     if (doit) {
         PRINTF("fullscreen\n");
         savegeometry(c);
@@ -321,10 +534,14 @@ void maximizeclient(Client *c, bool doit) {
         moveresize_win(c->win, 0, 0, c->geom.width, c->geom.height);
         focus(NULL);
     } else { /* unmax */
+        int32_t w = c->old_geom.width;
+        int32_t h = c->old_geom.height;
+        /* the hints may have changed while maximized */
+        applysizehints(c, &w, &h);
         c->geom.x = c->old_geom.x;
         c->geom.y = c->old_geom.y;
-        c->geom.width = c->old_geom.width;
-        c->geom.height = c->old_geom.height;
+        c->geom.width = w;
+        c->geom.height = h;
         PRINTF("(%d,%d) %dx%d\n", c->geom.x, c->geom.y, c->geom.width,
                c->geom.height);
         change_ewmh_flags(c, XCB_EWMH_WM_STATE_REMOVE, EWMH_FULLSCREEN);
@@ -339,6 +556,7 @@ void maximizeclient(Client *c, bool doit) {
                        c->geom.height);
         moveresize_win(c->win, 0, 0, c->geom.width, c->geom.height);
     }
+    geom_update(c);
 
     warp_pointer(c);
 }
@@ -372,6 +590,7 @@ void move(const Arg *arg) {
         warn("move: bad arg %d\n", arg->i);
     }
 
+    geom_update(sel);
     movewin(sel->frame, sel->geom.x, sel->geom.y);
     warp_pointer(sel);
 }
@@ -379,7 +598,7 @@ void move(const Arg *arg) {
 void movewin(xcb_window_t win, int16_t x, int16_t y) {
     const uint32_t values[] = {x, y};
     const uint32_t mask = XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y;
-    xcb_configure_window(conn, win, mask, values);
+    backend_configure(win, mask, values);
 }
 
 void moveresize_win(xcb_window_t win, int16_t x, int16_t y, uint16_t w,
@@ -387,7 +606,25 @@ void moveresize_win(xcb_window_t win, int16_t x, int16_t y, uint16_t w,
     const uint32_t values[] = {x, y, w, h};
     const uint32_t mask = XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y |
                           XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT;
-    xcb_configure_window(conn, win, mask, values);
+    backend_configure(win, mask, values);
+}
+
+/* move the frame and size the frame and client to match. the size must
+ * already have gone through applysizehints(). */
+void moveresize_client(Client *c, int16_t x, int16_t y, uint16_t w,
+                       uint16_t h) {
+    c->geom.x = x;
+    c->geom.y = y;
+    c->geom.width = w;
+    c->geom.height = h;
+    geom_update(c);
+    moveresize_win(c->frame, x, y, w, h);
+    resizewin(c->win, w, h);
+}
+
+void raiseclient(Client *c) {
+    raiseframe(c->frame);
+    raisewindow(c->win);
 }
 
 void raisewindow(xcb_drawable_t win) {
@@ -395,49 +632,37 @@ void raisewindow(xcb_drawable_t win) {
         return;
     PRINTF("raissewindow: %#x\n", win);
     const uint32_t values[] = {XCB_STACK_MODE_ABOVE};
-    xcb_configure_window(conn, win, XCB_CONFIG_WINDOW_STACK_MODE, values);
+    backend_configure(win, XCB_CONFIG_WINDOW_STACK_MODE, values);
 }
 
 void resize(const Arg *arg) {
     if (!sel)
         return;
 
+    prop_fetch(sel, PROP_NORMAL_HINTS);
+
     int32_t iw = resize_step;
     int32_t ih = resize_step;
+    int32_t w = sel->geom.width;
+    int32_t h = sel->geom.height;
 
     if (sel->size_hints.width_inc > 0)
         iw = sel->size_hints.width_inc;
     if (sel->size_hints.height_inc > 0)
         ih = sel->size_hints.height_inc;
 
-    if (arg->i == GrowHeight || arg->i == GrowBoth) {
-        if (sel->size_hints.max_height > 0) {
-            sel->geom.height =
-                MIN(sel->geom.height + ih, sel->size_hints.max_height);
-        } else {
-            sel->geom.height += ih;
-        }
-    }
-
-    if (arg->i == GrowWidth || arg->i == GrowBoth) {
-        if (sel->size_hints.max_width > 0) {
-            sel->geom.width =
-                MIN(sel->geom.width + ih, sel->size_hints.max_width);
-        } else {
-            sel->geom.width += ih;
-        }
-    }
-
-    if (arg->i == ShrinkHeight || arg->i == ShrinkBoth) {
-        if (sel->geom.height - ih > sel->size_hints.min_height)
-            sel->geom.height = sel->geom.height - ih;
-    }
-
-    if (arg->i == ShrinkWidth || arg->i == ShrinkBoth) {
-        if (sel->geom.width - iw > sel->size_hints.min_width)
-            sel->geom.width = sel->geom.width - iw;
-    }
-
+    if (arg->i == GrowHeight || arg->i == GrowBoth)
+        h += ih;
+    if (arg->i == GrowWidth || arg->i == GrowBoth)
+        w += iw;
+    if (arg->i == ShrinkHeight || arg->i == ShrinkBoth)
+        h -= ih;
+    if (arg->i == ShrinkWidth || arg->i == ShrinkBoth)
+        w -= iw;
+
+    applysizehints(sel, &w, &h);
+    sel->geom.width = w;
+    sel->geom.height = h;
     resizewin(sel->frame, sel->geom.width, sel->geom.height);
     resizewin(sel->win, sel->geom.width, sel->geom.height);
 
@@ -445,6 +670,7 @@ void resize(const Arg *arg) {
         change_ewmh_flags(sel, XCB_EWMH_WM_STATE_REMOVE, EWMH_FULLSCREEN);
         setborderwidth(sel->frame, border_width);
     }
+    geom_update(sel);
 
     if (ISMAXVERT(sel))
         change_ewmh_flags(sel, XCB_EWMH_WM_STATE_REMOVE, EWMH_MAXIMIZED_VERT);
@@ -461,7 +687,7 @@ void resizewin(xcb_window_t win, uint16_t w, uint16_t h) {
     PRINTF("reszewin: win %#x to %dx%d\n", win, w, h);
     const uint32_t values[] = {w, h};
     const uint32_t mask = XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT;
-    xcb_configure_window(conn, win, mask, values);
+    backend_configure(win, mask, values);
 }
 
 void savegeometry(Client *c) {
@@ -474,11 +700,7 @@ void savegeometry(Client *c) {
 }
 
 void send_client_message(Client *c, xcb_atom_t proto) {
-#if DEBUG
-    char *name = get_atom_name(proto);
-    PRINTF("send_client_message: %s to win %#x\n", name, c->win);
-    FREE(name);
-#endif
+    PRINTF("send_client_message: atom %u to win %#x\n", proto, c->win);
     xcb_client_message_event_t ev = {
         .response_type = XCB_CLIENT_MESSAGE,
         .format = 32,
@@ -488,7 +710,7 @@ void send_client_message(Client *c, xcb_atom_t proto) {
         .data.data32[0] = proto,
         .data.data32[1] = XCB_CURRENT_TIME,
     };
-    xcb_send_event(conn, false, c->win, XCB_EVENT_MASK_NO_EVENT, (char *)&ev);
+    backend_send_event(c->win, XCB_EVENT_MASK_NO_EVENT, &ev);
 }
 
 void setborder(Client *c, bool focus) {
@@ -496,32 +718,31 @@ void setborder(Client *c, bool focus) {
         return;
     uint32_t val[1];
     val[0] = focus ? focus_pixel : unfocus_pixel;
-    xcb_change_window_attributes(conn, c->frame, XCB_CW_BORDER_PIXEL, val);
+    backend_set_attributes(c->frame, XCB_CW_BORDER_PIXEL, val);
 }
 
 void setborderwidth(xcb_window_t win, uint16_t bw) {
     const uint32_t value[] = {bw};
     const uint32_t mask = XCB_CONFIG_WINDOW_BORDER_WIDTH;
-    xcb_configure_window(conn, win, mask, value);
+    backend_configure(win, mask, value);
 }
 
-void showhide(Client *c) {
-    if (!c)
-        return;
-    if (ISVISIBLE(c)) {
-        movewin(c->frame, c->geom.x, c->geom.y);
-        showhide(c->snext);
-    } else {
-        showhide(c->snext);
-        movewin(c->frame, (c->geom.width + 2 * border_width) * -2, c->geom.y);
-    }
+/* put the frames of the clients on workspaces a and b, and on no others,
+ * on or off screen: everything else is already hidden. visible ones go
+ * first, top of the stack first, so nothing shows through. */
+void showhide(unsigned int a, unsigned int b) {
+    Client *c;
+
+    for (c = stack; c; c = c->snext)
+        if (ISVISIBLE(c))
+            movewin(c->frame, c->geom.x, c->geom.y);
+    for (c = stack; c; c = c->snext)
+        if (!ISVISIBLE(c) && (c->ws == a || c->ws == b))
+            movewin(c->frame, HIDDEN_X(c), c->geom.y);
 }
 
 void spawn(const Arg *arg) {
-    if (strncmp(arg->com, "urxvt", 5) == 0)
-        launch_application(arg->com, true);
-    else
-        launch_application(arg->com, false);
+    launch_application(arg->cmd);
 }
 
 void teleport(const Arg *arg) {
@@ -558,6 +779,7 @@ void teleport_client(Client *c, uint16_t location) {
 
     PRINTF("teleport_client: win %#x to (%d,%d)\n", c->frame, c->geom.x,
            c->geom.y);
+    geom_update(c);
     if (c->frame)
         movewin(c->frame, c->geom.x, c->geom.y);
     else if (c->win)
@@ -576,61 +798,43 @@ void maximize_half_client(Client *c, uint16_t location) {
     const uint16_t sh = screen->height_in_pixels - 2 * border_width;
     const uint16_t half_sw = (screen->width_in_pixels / 2) - 2 * border_width;
     const uint16_t half_sh = (screen->height_in_pixels / 2) - 2 * border_width;
-
-    savegeometry(c);
+    int32_t w, h;
 
     switch (location) {
     case Left:
-        c->geom.x = 0;
-        c->geom.y = 0;
-        c->geom.width = half_sw;
-        c->geom.height = sh;
-        moveresize_win(c->frame, c->geom.x, c->geom.y, c->geom.width,
-                       c->geom.height);
-        moveresize_win(c->win, 0, 0, c->geom.width, c->geom.height);
-        change_ewmh_flags(c, XCB_EWMH_WM_STATE_ADD, EWMH_MAXIMIZED_VERT);
-        change_ewmh_flags(c, XCB_EWMH_WM_STATE_REMOVE, EWMH_MAXIMIZED_HORZ);
-        break;
     case Right:
-        c->geom.y = 0;
-        c->geom.width = half_sw;
-        c->geom.x =
-            screen->width_in_pixels - (c->geom.width + 2 * border_width);
-        c->geom.height = sh;
-        moveresize_win(c->frame, c->geom.x, c->geom.y, c->geom.width,
-                       c->geom.height);
-        moveresize_win(c->win, 0, 0, c->geom.width, c->geom.height);
-        change_ewmh_flags(c, XCB_EWMH_WM_STATE_ADD, EWMH_MAXIMIZED_VERT);
-        change_ewmh_flags(c, XCB_EWMH_WM_STATE_REMOVE, EWMH_MAXIMIZED_HORZ);
+        w = half_sw;
+        h = sh;
         break;
     case Top:
-        c->geom.x = 0;
-        c->geom.y = 0;
-        c->geom.width = sw;
-        c->geom.height = half_sh;
-        moveresize_win(c->frame, c->geom.x, c->geom.y, c->geom.width,
-                       c->geom.height);
-        moveresize_win(c->win, 0, 0, c->geom.width, c->geom.height);
-        change_ewmh_flags(c, XCB_EWMH_WM_STATE_ADD, EWMH_MAXIMIZED_VERT);
-        change_ewmh_flags(c, XCB_EWMH_WM_STATE_REMOVE, EWMH_MAXIMIZED_HORZ);
-        break;
     case Bottom:
-        c->geom.x = 0;
-        c->geom.width = sw;
-        c->geom.height = half_sh;
-        c->geom.y =
-            screen->height_in_pixels - (c->geom.height + 2 * border_width);
-        moveresize_win(c->frame, c->geom.x, c->geom.y, c->geom.width,
-                       c->geom.height);
-        moveresize_win(c->win, 0, 0, c->geom.width, c->geom.height);
-        change_ewmh_flags(c, XCB_EWMH_WM_STATE_ADD, EWMH_MAXIMIZED_VERT);
-        change_ewmh_flags(c, XCB_EWMH_WM_STATE_REMOVE, EWMH_MAXIMIZED_HORZ);
+        w = sw;
+        h = half_sh;
         break;
     default:
         warn("maximize_half_client: bad arg %d\n", location);
+        return;
     }
+
+    savegeometry(c);
+    applysizehints(c, &w, &h);
+
+    /* right and bottom halves stay flush with the screen edge */
+    if (location == Right)
+        moveresize_client(c, screen->width_in_pixels - (w + 2 * border_width),
+                          0, w, h);
+    else if (location == Bottom)
+        moveresize_client(c, 0,
+                          screen->height_in_pixels - (h + 2 * border_width), w,
+                          h);
+    else
+        moveresize_client(c, 0, 0, w, h);
+
+    change_ewmh_flags(c, XCB_EWMH_WM_STATE_ADD, EWMH_MAXIMIZED_VERT);
+    change_ewmh_flags(c, XCB_EWMH_WM_STATE_REMOVE, EWMH_MAXIMIZED_HORZ);
     change_ewmh_flags(c, XCB_EWMH_WM_STATE_REMOVE, EWMH_FULLSCREEN);
     ewmh_update_wm_state(c);
+    geom_update(c);
 
     PRINTF("maximize_half win %#x to (%d,%d) %dx%d\n", c->frame, c->geom.x,
            c->geom.y, c->geom.width, c->geom.height);
@@ -641,33 +845,40 @@ void maximize_half_client(Client *c, uint16_t location) {
 }
 
 void unmanage(Client *c) {
+    const bool framed = !ISUNFRAMED(c);
+    StatsMark mark;
+
+    stats_start(&mark, STAT_UNMANAGE);
     PRINTF("unmanage: %#x\n", c->win);
+    memo_save(c);
     detach(c);
-    detachstack(c);
+    if (framed) {
+        detachstack(c);
+        geom_remove(c);
+    }
     if (c->frame)
-        xcb_destroy_window(conn, c->frame);
-    FREE(c);
+        backend_destroy(c->frame);
+    /* the next oldest takes its place at the bottom of the layer */
+    if (c->win == layer_floor) {
+        layer_floor = XCB_NONE;
+        for (Client *t = clients; t; t = t->next)
+            if (above_frames(t))
+                layer_floor = t->win;
+    }
+    prop_wipe(c);
+    client_free(c);
     ewmh_update_client_list(clients);
-    focus(NULL);
-}
-
-Client *wintoclient(xcb_window_t w) {
-    Client *c;
-    for (c = clients; c; c = c->next)
-        if (w == c->win)
-            return c;
-    return NULL;
-}
-
-Client *frame_to_client(xcb_window_t f) {
-    Client *c;
-    for (c = clients; c; c = c->next)
-        if (f == c->frame)
-            return c;
-    return NULL;
+    /* a tooltip or notification going leaves the focus where it is */
+    if (framed)
+        focus(NULL);
+    stats_record(&mark);
 }
 
 void focus(Client *c) {
+    if (c && ISUNFRAMED(c))
+        return;
+    StatsMark mark;
+    stats_start(&mark, STAT_FOCUS);
     if (!c || !ISVISIBLE(c))
         for (c = stack; c && !ISVISIBLE(c); c = c->snext)
             if (sel && sel != c)
@@ -680,17 +891,18 @@ void focus(Client *c) {
             setborder(sel, false);
         setborder(c, true);
         PRINTF("focus: %#x\n", c->win);
-        xcb_set_input_focus(conn, XCB_INPUT_FOCUS_POINTER_ROOT, c->win,
-                            XCB_CURRENT_TIME);
-        xcb_change_property(conn, XCB_PROP_MODE_REPLACE, screen->root,
-                            ewmh->_NET_ACTIVE_WINDOW, XCB_ATOM_WINDOW, 32, 1,
-                            &c->win);
+        backend_focus(c->win);
+        backend_set_property(screen->root, XCB_PROP_MODE_REPLACE,
+                             ewmh->_NET_ACTIVE_WINDOW, XCB_ATOM_WINDOW, 32, 1,
+                             &c->win);
         warp_pointer(c);
+        launch_focused(c->win);
     } else {
-        xcb_delete_property(conn, screen->root, ewmh->_NET_ACTIVE_WINDOW);
-        xcb_set_input_focus(conn, XCB_NONE, XCB_INPUT_FOCUS_POINTER_ROOT,
-                            XCB_CURRENT_TIME);
+        backend_delete_property(screen->root, ewmh->_NET_ACTIVE_WINDOW);
+        backend_focus(XCB_NONE);
     }
 
     sel = c;
+    trace_section(STAT_FOCUS, c ? c->win : XCB_NONE, mark.time,
+                  stats_record(&mark));
 }
@@ -17,13 +17,18 @@
 #define ISFULLSCREEN(C) ((C)->ewmh_flags & EWMH_FULLSCREEN)
 #define ISMAXVERT(C)    ((C)->ewmh_flags & EWMH_MAXIMIZED_VERT)
 #define ISMAXHORZ(C)    ((C)->ewmh_flags & EWMH_MAXIMIZED_HORZ)
+#define ISUNFRAMED(C)   ((C)->type > WINTYPE_DIALOG)
+/* where a frame waits while its workspace isn't shown */
+#define HIDDEN_X(C)     (((C)->geom.width + 2 * border_width) * -2)
 #define MIN(X, Y)       ((X) < (Y) ? (X) : (Y))
+#define MAX(X, Y)       ((X) > (Y) ? (X) : (Y))
 
 void applyrules(Client *c);
+void applysizehints(Client *c, int32_t *w, int32_t *h);
 void cycleclients(const Arg *arg);
-void fitclient(Client *c);
+void fit_all_in_screen(void);
+void focusdir(const Arg *arg);
 void focus(Client *c);
-Client *frame_to_client(xcb_window_t f);
 void killselected(const Arg *arg);
 void manage(xcb_window_t w);
 void maximize(const Arg *arg);
@@ -34,21 +39,25 @@ void move(const Arg *arg);
 void movewin(xcb_window_t win, int16_t x, int16_t y);
 void moveresize_win(xcb_window_t win, int16_t x, int16_t y, uint16_t w,
                     uint16_t h);
+void moveresize_client(Client *c, int16_t x, int16_t y, uint16_t w,
+                       uint16_t h);
+void raiseclient(Client *c);
 void raisewindow(xcb_drawable_t win);
 void reparent(Client *c);
 void resize(const Arg *arg);
 void resizewin(xcb_window_t win, uint16_t w, uint16_t h);
 void savegeometry(Client *c);
+void setsizehints(Client *c, const xcb_size_hints_t *sh);
 void send_client_message(Client *c, xcb_atom_t proto);
 void setborder(Client *c, bool focus);
 void setborderwidth(xcb_window_t win, uint16_t bw);
-void showhide(Client *c);
+void showhide(unsigned int a, unsigned int b);
+void swapdir(const Arg *arg);
 void spawn(const Arg *arg);
 void teleport(const Arg *arg);
 void teleport_client(Client *c, uint16_t location);
 void maximize_half(const Arg *arg);
 void maximize_half_client(Client *c, uint16_t location);
 void unmanage(Client *c);
-Client *wintoclient(xcb_window_t w);
 
 #endif
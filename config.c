@@ -13,6 +13,7 @@
 #include "list.h"
 #include "log.h"
 #include "config.h"
+#include "place.h"
 
 #define OPT(_opt) (strcmp(_opt, key) == 0)
 #define PATH_MAX 256
@@ -36,6 +37,11 @@ static const struct {
     {OPTION, "focus_color", setopt},
     {OPTION, "unfocus_color", setopt},
     {OPTION, "center_new_windows", setopt},
+    {OPTION, "placement", setopt},
+    {OPTION, "launch_helper", setopt},
+    {OPTION, "snap_distance", setopt},
+    {OPTION, "edge_resistance", setopt},
+    {OPTION, "remember_geometry", setopt},
     {KEYBIND, "move_up", set_key},
     {KEYBIND, "move_down", set_key},
     {KEYBIND, "move_left", set_key},
@@ -105,28 +111,44 @@ static const struct {
     {KEYBIND, "maximize_half_right", set_key},
     {KEYBIND, "maximize_half_bottom", set_key},
     {KEYBIND, "maximize_half_top", set_key},
+    {KEYBIND, "focus_left", set_key},
+    {KEYBIND, "focus_right", set_key},
+    {KEYBIND, "focus_up", set_key},
+    {KEYBIND, "focus_down", set_key},
+    {KEYBIND, "swap_left", set_key},
+    {KEYBIND, "swap_right", set_key},
+    {KEYBIND, "swap_up", set_key},
+    {KEYBIND, "swap_down", set_key},
 };
 
-static char terminal[] = "urxvt";
-static char terminal2[] = "termite";
-static char browser[] = "chromium";
-static char browser2[] = "firefox";
-static char launcher[] = "rofi -show run";
-static char mpctoggle[] = "mpc -q toggle";
-static char mpcseekf[] = "mpc -q seek +30";
-static char mpcseekb[] = "mpc -q seek -30";
-static char mpcnext[] = "mpc -q next";
-static char mpcprev[] = "mpc -q prev";
-static char volup[] = "amixer -q set Master 3%+ unmute";
-static char voldown[] = "amixer -q set Master 3%- unmute";
-static char voltoggle[] = "amixer -q set Master toggle";
+/* command         startup notification  dir   env   memory limit */
+static const Command terminal = {"urxvt", true, NULL, NULL, 0};
+static const Command terminal2 = {"termite", false, NULL, NULL, 0};
+static const Command browser = {"chromium", false, NULL, NULL, 0};
+static const Command browser2 = {"firefox", false, NULL, NULL, 0};
+static const Command launcher = {"rofi -show run", false, NULL, NULL, 0};
+static const Command mpctoggle = {"mpc -q toggle", false, NULL, NULL, 0};
+static const Command mpcseekf = {"mpc -q seek +30", false, NULL, NULL, 0};
+static const Command mpcseekb = {"mpc -q seek -30", false, NULL, NULL, 0};
+static const Command mpcnext = {"mpc -q next", false, NULL, NULL, 0};
+static const Command mpcprev = {"mpc -q prev", false, NULL, NULL, 0};
+static const Command volup = {
+    "amixer -q set Master 3%+ unmute", false, NULL, NULL, 0};
+static const Command voldown = {
+    "amixer -q set Master 3%- unmute", false, NULL, NULL, 0};
+static const Command voltoggle = {
+    "amixer -q set Master toggle", false, NULL, NULL, 0};
 
 int border_width = 2;
 int move_step = 30;
 int resize_step = 30;
 int cursor_position = 0;
+int placement = PLACE_CENTER;
+int snap_distance = 10;
+int edge_resistance = 0;
 bool java_workaround = false;
-bool center_new_windows = true;
+bool launch_helper = true;
+bool remember_geometry = false;
 char *focus_color;
 char *unfocus_color;
 
@@ -182,35 +204,35 @@ static void set_key(const char *key, char *val) {
     } while ((token = strtok(NULL, "+")));
 
     if (OPT("terminal1")) {
-        keys[0] = (Key){mod, keysym, spawn, {.com = terminal}};
+        keys[0] = (Key){mod, keysym, spawn, {.cmd = &terminal}};
     } else if (OPT("terminal2")) {
-        keys[1] = (Key){mod, keysym, spawn, {.com = terminal2}};
+        keys[1] = (Key){mod, keysym, spawn, {.cmd = &terminal2}};
     } else if (OPT("browser")) {
-        keys[2] = (Key){mod, keysym, spawn, {.com = browser}};
+        keys[2] = (Key){mod, keysym, spawn, {.cmd = &browser}};
     } else if (OPT("browser2")) {
-        keys[3] = (Key){mod, keysym, spawn, {.com = browser2}};
+        keys[3] = (Key){mod, keysym, spawn, {.cmd = &browser2}};
     } else if (OPT("launcher")) {
-        keys[4] = (Key){mod, keysym, spawn, {.com = launcher}};
+        keys[4] = (Key){mod, keysym, spawn, {.cmd = &launcher}};
     } else if (OPT("mpc_toggle")) {
-        keys[5] = (Key){mod, keysym, spawn, {.com = mpctoggle}};
+        keys[5] = (Key){mod, keysym, spawn, {.cmd = &mpctoggle}};
     } else if (OPT("mpc_seek_f")) {
-        keys[6] = (Key){mod, keysym, spawn, {.com = mpcseekf}};
+        keys[6] = (Key){mod, keysym, spawn, {.cmd = &mpcseekf}};
     } else if (OPT("mpc_seek_b")) {
-        keys[7] = (Key){mod, keysym, spawn, {.com = mpcseekb}};
+        keys[7] = (Key){mod, keysym, spawn, {.cmd = &mpcseekb}};
     } else if (OPT("mpc_next")) {
-        keys[8] = (Key){mod, keysym, spawn, {.com = mpcnext}};
+        keys[8] = (Key){mod, keysym, spawn, {.cmd = &mpcnext}};
     } else if (OPT("mpc_prev")) {
-        keys[9] = (Key){mod, keysym, spawn, {.com = mpcprev}};
+        keys[9] = (Key){mod, keysym, spawn, {.cmd = &mpcprev}};
     } else if (OPT("vol_up")) {
-        keys[10] = (Key){mod, keysym, spawn, {.com = volup}};
+        keys[10] = (Key){mod, keysym, spawn, {.cmd = &volup}};
     } else if (OPT("vol_down")) {
-        keys[11] = (Key){mod, keysym, spawn, {.com = voldown}};
+        keys[11] = (Key){mod, keysym, spawn, {.cmd = &voldown}};
     } else if (OPT("vol_up2")) {
-        keys[12] = (Key){mod, keysym, spawn, {.com = volup}};
+        keys[12] = (Key){mod, keysym, spawn, {.cmd = &volup}};
     } else if (OPT("vol_down2")) {
-        keys[13] = (Key){mod, keysym, spawn, {.com = voldown}};
+        keys[13] = (Key){mod, keysym, spawn, {.cmd = &voldown}};
     } else if (OPT("vol_toggle")) {
-        keys[14] = (Key){mod, keysym, spawn, {.com = voltoggle}};
+        keys[14] = (Key){mod, keysym, spawn, {.cmd = &voltoggle}};
     } else if (OPT("resize_grow_height")) {
         keys[15] = (Key){mod, keysym, resize, {.i = GrowHeight}};
     } else if (OPT("resize_grow_width")) {
@@ -271,6 +293,22 @@ static void set_key(const char *key, char *val) {
         keys[63] = (Key){mod, keysym, maximize_half, {.i = Bottom}};
     } else if (OPT("maximize_half_top")) {
         keys[64] = (Key){mod, keysym, maximize_half, {.i = Top}};
+    } else if (OPT("focus_left")) {
+        keys[65] = (Key){mod, keysym, focusdir, {.i = Left}};
+    } else if (OPT("focus_right")) {
+        keys[66] = (Key){mod, keysym, focusdir, {.i = Right}};
+    } else if (OPT("focus_up")) {
+        keys[67] = (Key){mod, keysym, focusdir, {.i = Top}};
+    } else if (OPT("focus_down")) {
+        keys[68] = (Key){mod, keysym, focusdir, {.i = Bottom}};
+    } else if (OPT("swap_left")) {
+        keys[69] = (Key){mod, keysym, swapdir, {.i = Left}};
+    } else if (OPT("swap_right")) {
+        keys[70] = (Key){mod, keysym, swapdir, {.i = Right}};
+    } else if (OPT("swap_up")) {
+        keys[71] = (Key){mod, keysym, swapdir, {.i = Top}};
+    } else if (OPT("swap_down")) {
+        keys[72] = (Key){mod, keysym, swapdir, {.i = Bottom}};
     }
 }
 
@@ -282,10 +320,14 @@ static void setopt(const char *key, char *val) {
         if (border_width < 0)
             border_width = 0;
     } else if (OPT("focus_color")) {
-        focus_color = malloc(strlen(val) + 1);
+        FREE(focus_color);
+        if (!(focus_color = malloc(strlen(val) + 1)))
+            err("can't allocate memory.");
         snprintf(focus_color, strlen(val) + 1, "%s", val);
     } else if (OPT("unfocus_color")) {
-        unfocus_color = malloc(strlen(val) + 1);
+        FREE(unfocus_color);
+        if (!(unfocus_color = malloc(strlen(val) + 1)))
+            err("can't allocate memory.");
         snprintf(unfocus_color, strlen(val) + 1, "%s", val);
     } else if (OPT("move_step")) {
         move_step = atoi(val);
@@ -302,7 +344,24 @@ static void setopt(const char *key, char *val) {
         if (cursor_position < 0)
             cursor_position = 0;
     } else if (OPT("center_new_windows")) {
-        center_new_windows = (atoi(val) != 0);
+        /* from before there was a choice */
+        placement = atoi(val) != 0 ? PLACE_CENTER : PLACE_NONE;
+    } else if (OPT("placement")) {
+        placement = atoi(val);
+        if (placement < 0 || placement >= PLACE_MAX)
+            placement = PLACE_CENTER;
+    } else if (OPT("launch_helper")) {
+        launch_helper = (atoi(val) != 0);
+    } else if (OPT("snap_distance")) {
+        snap_distance = atoi(val);
+        if (snap_distance < 0)
+            snap_distance = 0;
+    } else if (OPT("edge_resistance")) {
+        edge_resistance = atoi(val);
+        if (edge_resistance < 0)
+            edge_resistance = 0;
+    } else if (OPT("remember_geometry")) {
+        remember_geometry = (atoi(val) != 0);
     } else {
         warn("setopt: no handler for %s\n", key);
     }
@@ -8,14 +8,18 @@
 char *find_config(const char *);
 int parse_config(const char *);
 
-extern bool center_new_windows;
 extern int border_width;
 extern char *focus_color;
 extern char *unfocus_color;
 extern int move_step;
 extern int resize_step;
 extern bool java_workaround;
+extern bool launch_helper;
+extern bool remember_geometry;
 extern int cursor_position;
+extern int placement;
+extern int snap_distance;
+extern int edge_resistance;
 extern uint32_t focus_pixel;
 extern uint32_t unfocus_pixel;
 
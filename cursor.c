@@ -2,6 +2,7 @@
 #include <xcb/xcb_cursor.h>
 #include <string.h>
 #include "main.h"
+#include "backend.h"
 #include "log.h"
 #include "cursor.h"
 
@@ -51,8 +52,7 @@ xcb_cursor_t cursor_get_id(enum cursor_t c) {
 
 void cursor_set_window_cursor(xcb_window_t win, enum cursor_t c) {
     if (c < XC_MAX)
-        xcb_change_window_attributes(conn, win, XCB_CW_CURSOR,
-                                     (uint32_t[]){cursors[c]});
+        backend_set_attributes(win, XCB_CW_CURSOR, (uint32_t[]){cursors[c]});
 }
 
 void cursor_free_context(void) {
@@ -60,3 +60,12 @@ void cursor_free_context(void) {
         xcb_free_cursor(conn, cursors[i]);
     xcb_cursor_context_free(ctx);
 }
+
+int cursor_count(void) {
+    int n = 0;
+
+    for (int i = 0; i < LENGTH(cursors); ++i)
+        if (cursors[i])
+            n++;
+    return n;
+}
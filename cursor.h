@@ -17,5 +17,6 @@ void cursor_load_cursors(void);
 xcb_cursor_t cursor_get_id(enum cursor_t c);
 void cursor_set_window_cursor(xcb_window_t win, enum cursor_t c);
 void cursor_free_context(void);
+int cursor_count(void);
 
 #endif
@@ -1,8 +1,10 @@
 /* See LICENSE file for copyright and license details. */
+#include <stdlib.h>
 #include <string.h>
 #include <xcb/xcb_event.h>
 #include <xcb/xcb_icccm.h>
 #include "main.h"
+#include "backend.h"
 #include "list.h"
 #include "events.h"
 #include "keys.h"
@@ -11,19 +13,36 @@
 #include "config.h"
 #include "client.h"
 #include "cursor.h"
+#include "geom.h"
+#include "memo.h"
+#include "prop.h"
+#include "workspace.h"
+#include "stats.h"
+#include "trace.h"
 #include "log.h"
 
+#define PENDING_MAX 32
+
+/* work deferred until the event queue is drained or another kind of event
+ * arrives: property changes, one entry per (window, atom) with the
+ * sequence number of the latest, and configure requests, one merged entry
+ * per window. */
+static struct {
+    xcb_window_t win;
+    xcb_atom_t atom;
+    unsigned int seq;
+} pending_props[PENDING_MAX];
+static int npending_props;
+static xcb_configure_request_event_t pending_configs[PENDING_MAX];
+static int npending_configs;
+
 static void clientmessage(xcb_generic_event_t *ev) {
     xcb_client_message_event_t *e = (xcb_client_message_event_t *)ev;
 
-#ifdef DEBUG
-    char *name = get_atom_name(e->type);
-    PRINTF("Event: client message: %s win %#x\n", name, e->window);
-    FREE(name);
-#endif
     /* delegate startup-notification client messages to the lib.
-     * will use startup_event_cb() as the callback. */
-    if (sn_xcb_display_process_event(sndisplay, (xcb_generic_event_t *)e))
+     * will use startup_event_cb() as the callback. a replay has none. */
+    if (sndisplay &&
+        sn_xcb_display_process_event(sndisplay, (xcb_generic_event_t *)e))
         return;
 
     Client *c;
@@ -31,161 +50,238 @@ static void clientmessage(xcb_generic_event_t *ev) {
         return;
 
     if (e->type == ewmh->_NET_WM_STATE) {
+        if (ISUNFRAMED(c))
+            return;
         handle_wm_state(c, e->data.data32[1], e->data.data32[0]);
         handle_wm_state(c, e->data.data32[2], e->data.data32[0]);
     } else if (e->type == ewmh->_NET_ACTIVE_WINDOW) {
+        prop_fetch(c, PROP_PROTOCOLS);
         if (c->can_focus)
             focus(c);
     } else if (e->type == ewmh->_NET_WM_DESKTOP) {
     } else if (e->type == ewmh->_NET_MOVERESIZE_WINDOW) {
     } else if (e->type == ewmh->_NET_REQUEST_FRAME_EXTENTS) {
-        xcb_ewmh_set_frame_extents(ewmh, c->win, border_width, border_width,
-                                   border_width, border_width);
+        ewmh_set_frame_extents(c);
     } else if (e->type == ewmh->_NET_CLOSE_WINDOW) {
+        prop_fetch(c, PROP_PROTOCOLS);
         if (c->can_delete)
             send_client_message(c, WM_DELETE_WINDOW);
     }
 }
 
-static void configurerequest(xcb_generic_event_t *ev) {
-    xcb_configure_request_event_t *e = (xcb_configure_request_event_t *)ev;
-    Client *c;
+/* only the root's own are of interest: a screen size change */
+static void configurenotify(xcb_generic_event_t *ev) {
+    xcb_configure_notify_event_t *e = (xcb_configure_notify_event_t *)ev;
+
+    if (e->window != screen->root)
+        return;
+    if (e->width == screen->width_in_pixels &&
+        e->height == screen->height_in_pixels)
+        return;
+    screen->width_in_pixels = e->width;
+    screen->height_in_pixels = e->height;
+    geom_resize();
+    fit_all_in_screen();
+}
+
+/* pass a request from a window we don't frame straight through */
+static void configure_unmanaged(xcb_configure_request_event_t *e) {
     uint32_t v[7];
     int i = 0;
     uint16_t mask = 0;
 
-#ifdef DEBUG
-    PRINTF("Event: configure request: win %#x: ", e->window);
+    if (e->value_mask & XCB_CONFIG_WINDOW_X) {
+        mask |= XCB_CONFIG_WINDOW_X;
+        v[i++] = e->x;
+    }
+    if (e->value_mask & XCB_CONFIG_WINDOW_Y) {
+        mask |= XCB_CONFIG_WINDOW_Y;
+        v[i++] = e->y;
+    }
+    if (e->value_mask & XCB_CONFIG_WINDOW_WIDTH) {
+        mask |= XCB_CONFIG_WINDOW_WIDTH;
+        v[i++] = e->width;
+    }
+    if (e->value_mask & XCB_CONFIG_WINDOW_HEIGHT) {
+        mask |= XCB_CONFIG_WINDOW_HEIGHT;
+        v[i++] = e->height;
+    }
+    if (e->value_mask & XCB_CONFIG_WINDOW_BORDER_WIDTH) {
+        mask |= XCB_CONFIG_WINDOW_BORDER_WIDTH;
+        v[i++] = e->border_width;
+    }
+    if (e->value_mask & XCB_CONFIG_WINDOW_SIBLING) {
+        mask |= XCB_CONFIG_WINDOW_SIBLING;
+        v[i++] = e->sibling;
+    }
+    if (e->value_mask & XCB_CONFIG_WINDOW_STACK_MODE) {
+        mask |= XCB_CONFIG_WINDOW_STACK_MODE;
+        v[i++] = e->stack_mode;
+    }
+
+    if (i > 0)
+        backend_configure(e->window, mask, v);
+}
+
+/* tell c where it is, whether its request was granted, refused or
+ * only moved the frame (ICCCM 4.1.5): root-relative, inside the frame's
+ * border, and off screen while its workspace is hidden */
+static void send_configure_notify(Client *c) {
+    const int32_t fb = (BWIDTH(c) - c->geom.width) / 2;
+    xcb_configure_notify_event_t evt;
+
+    memset(&evt, '\0', sizeof evt);
+    evt.response_type = XCB_CONFIGURE_NOTIFY;
+    evt.event = c->win;
+    evt.window = c->win;
+    evt.above_sibling = XCB_NONE;
+    evt.x = (ISVISIBLE(c) ? c->geom.x : HIDDEN_X(c)) + fb;
+    evt.y = c->geom.y + fb;
+    evt.width = c->geom.width;
+    evt.height = c->geom.height;
+    evt.border_width = 0;
+    evt.override_redirect = 0;
+    backend_send_event(c->win, XCB_EVENT_MASK_STRUCTURE_NOTIFY, &evt);
+}
+
+/* the frame takes the position and size, the client only the size. the
+ * requested border width is ignored since the frame draws the border and
+ * the client's own is kept at 0. a client on a hidden workspace keeps its
+ * frame off screen, and the new position waits in geom for the workspace
+ * to be shown. */
+static void configure_client(Client *c, xcb_configure_request_event_t *e) {
+    int32_t x = c->geom.x;
+    int32_t y = c->geom.y;
+    int32_t w = c->geom.width;
+    int32_t h = c->geom.height;
+    uint32_t v[6];
+    int i = 0;
+    uint16_t mask = 0;
+
     if (e->value_mask & XCB_CONFIG_WINDOW_X)
-        PRINTF("x: %d ", e->x);
+        x = e->x;
     if (e->value_mask & XCB_CONFIG_WINDOW_Y)
-        PRINTF("y: %d ", e->y);
+        y = e->y;
     if (e->value_mask & XCB_CONFIG_WINDOW_WIDTH)
-        PRINTF("w: %u ", e->width);
+        w = e->width;
     if (e->value_mask & XCB_CONFIG_WINDOW_HEIGHT)
-        PRINTF("h: %u ", e->height);
-    if (e->value_mask & XCB_CONFIG_WINDOW_BORDER_WIDTH)
-        PRINTF("border: %u ", e->border_width);
-    if (e->value_mask & XCB_CONFIG_WINDOW_SIBLING)
-        PRINTF("sibling: %#x ", e->sibling);
-    if (e->value_mask & XCB_CONFIG_WINDOW_STACK_MODE)
-        PRINTF("stack mode: %u", e->stack_mode);
-    PRINTF("\n");
-#endif
-
-    if ((c = wintoclient(e->window))) {
-        if (e->value_mask & XCB_CONFIG_WINDOW_X) {
-            mask |= XCB_CONFIG_WINDOW_X;
-            v[i++] = e->x;
-            c->geom.x = e->x;
-        }
-        if (e->value_mask & XCB_CONFIG_WINDOW_Y) {
-            mask |= XCB_CONFIG_WINDOW_Y;
-            v[i++] = e->y;
-            c->geom.y = e->y;
-        }
-        if (e->value_mask & XCB_CONFIG_WINDOW_WIDTH) {
-            mask |= XCB_CONFIG_WINDOW_WIDTH;
-            v[i++] = e->width;
-            c->geom.width = e->width;
-        }
-        if (e->value_mask & XCB_CONFIG_WINDOW_HEIGHT) {
-            mask |= XCB_CONFIG_WINDOW_HEIGHT;
-            v[i++] = e->height;
-            c->geom.height = e->height;
-        }
-        if (e->value_mask & XCB_CONFIG_WINDOW_SIBLING) {
+        h = e->height;
+
+    applysizehints(c, &w, &h);
+
+    const bool moved = x != c->geom.x || y != c->geom.y;
+    const bool resized = w != c->geom.width || h != c->geom.height;
+
+    c->geom.x = x;
+    c->geom.y = y;
+    c->geom.width = w;
+    c->geom.height = h;
+    geom_update(c);
+
+    if (moved && ISVISIBLE(c)) {
+        mask |= XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y;
+        v[i++] = x;
+        v[i++] = y;
+    } else if ((moved || resized) && !ISVISIBLE(c)) {
+        /* where it hides depends on its width */
+        mask |= XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y;
+        v[i++] = HIDDEN_X(c);
+        v[i++] = y;
+    }
+    if (resized) {
+        mask |= XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT;
+        v[i++] = w;
+        v[i++] = h;
+    }
+    if (e->value_mask & XCB_CONFIG_WINDOW_SIBLING) {
+        Client *s = wintoclient(e->sibling);
+        if (s && s->frame) {
             mask |= XCB_CONFIG_WINDOW_SIBLING;
-            v[i++] = e->sibling;
-        }
-        if (e->value_mask & XCB_CONFIG_WINDOW_STACK_MODE) {
-            mask |= XCB_CONFIG_WINDOW_STACK_MODE;
-            v[i++] = e->stack_mode;
-        }
-        if (e->value_mask & XCB_CONFIG_WINDOW_BORDER_WIDTH) {
-            /* mask |= XCB_CONFIG_WINDOW_BORDER_WIDTH; */
-            /* v[i++] = e->border_width; */
-            setborder(c, true);
+            v[i++] = s->frame;
         }
+    }
+    if (e->value_mask & XCB_CONFIG_WINDOW_STACK_MODE) {
+        mask |= XCB_CONFIG_WINDOW_STACK_MODE;
+        v[i++] = e->stack_mode;
+    }
+    /* a sibling without a stack mode is an error */
+    if (!(mask & XCB_CONFIG_WINDOW_STACK_MODE))
+        mask &= ~XCB_CONFIG_WINDOW_SIBLING;
 
-        if (i > 0) {
-            xcb_configure_window(conn, c->win, mask, v);
-            xcb_configure_window(conn, c->frame, mask, v);
-        }
+    if (i > 0)
+        backend_configure(c->frame, mask, v);
 
-        xcb_configure_notify_event_t evt;
-        memset(&evt, '\0', sizeof evt);
-
-        evt.response_type = XCB_CONFIGURE_NOTIFY;
-        evt.event = c->win;
-        evt.window = c->win;
-        evt.above_sibling = XCB_NONE;
-        evt.x = c->geom.x;
-        evt.y = c->geom.y;
-        evt.width = c->geom.width;
-        evt.height = c->geom.height;
-        evt.border_width = 0;
-        evt.override_redirect = 0;
-        xcb_send_event(conn, false, c->win, XCB_EVENT_MASK_STRUCTURE_NOTIFY,
-                       (const char *)&evt);
-    } else {
-        if (e->value_mask & XCB_CONFIG_WINDOW_X) {
-            mask |= XCB_CONFIG_WINDOW_X;
-            v[i++] = e->x;
-        }
-        if (e->value_mask & XCB_CONFIG_WINDOW_Y) {
-            mask |= XCB_CONFIG_WINDOW_Y;
-            v[i++] = e->y;
-        }
-        if (e->value_mask & XCB_CONFIG_WINDOW_WIDTH) {
-            mask |= XCB_CONFIG_WINDOW_WIDTH;
-            v[i++] = e->width;
-        }
-        if (e->value_mask & XCB_CONFIG_WINDOW_HEIGHT) {
-            mask |= XCB_CONFIG_WINDOW_HEIGHT;
-            v[i++] = e->height;
-        }
-        if (e->value_mask & XCB_CONFIG_WINDOW_SIBLING) {
-            mask |= XCB_CONFIG_WINDOW_SIBLING;
-            v[i++] = e->sibling;
-        }
-        if (e->value_mask & XCB_CONFIG_WINDOW_STACK_MODE) {
-            mask |= XCB_CONFIG_WINDOW_STACK_MODE;
-            v[i++] = e->stack_mode;
-        }
-        if (e->value_mask & XCB_CONFIG_WINDOW_BORDER_WIDTH) {
-            mask |= XCB_CONFIG_WINDOW_BORDER_WIDTH;
-            v[i++] = e->border_width;
-        }
+    if (resized)
+        resizewin(c->win, w, h);
+    send_configure_notify(c);
+}
 
-        if (i > 0)
-            xcb_configure_window(conn, e->window, mask, v);
+static void flushconfigures(void) {
+    Client *c;
+
+    for (int i = 0; i < npending_configs; i++) {
+        xcb_configure_request_event_t *e = &pending_configs[i];
+        /* unframed windows place themselves */
+        if ((c = wintoclient(e->window)) && !ISUNFRAMED(c))
+            configure_client(c, e);
+        else
+            configure_unmanaged(e);
     }
+    npending_configs = 0;
+}
+
+static void configurerequest(xcb_generic_event_t *ev) {
+    xcb_configure_request_event_t *e = (xcb_configure_request_event_t *)ev;
+    Client *c;
+
+    if (!(c = wintoclient(e->window)) || ISUNFRAMED(c)) {
+        configure_unmanaged(e);
+        return;
+    }
+
+    /* merge into an earlier request for the same window, later values win */
+    for (int i = 0; i < npending_configs; i++) {
+        xcb_configure_request_event_t *p = &pending_configs[i];
+        if (p->window != e->window)
+            continue;
+        if (e->value_mask & XCB_CONFIG_WINDOW_X)
+            p->x = e->x;
+        if (e->value_mask & XCB_CONFIG_WINDOW_Y)
+            p->y = e->y;
+        if (e->value_mask & XCB_CONFIG_WINDOW_WIDTH)
+            p->width = e->width;
+        if (e->value_mask & XCB_CONFIG_WINDOW_HEIGHT)
+            p->height = e->height;
+        if (e->value_mask & XCB_CONFIG_WINDOW_SIBLING)
+            p->sibling = e->sibling;
+        if (e->value_mask & XCB_CONFIG_WINDOW_STACK_MODE)
+            p->stack_mode = e->stack_mode;
+        p->value_mask |= e->value_mask;
+        return;
+    }
+
+    if (npending_configs == PENDING_MAX)
+        handlepending();
+    pending_configs[npending_configs++] = *e;
 }
 
 static void enternotify(xcb_generic_event_t *ev) {
     xcb_enter_notify_event_t *e = (xcb_enter_notify_event_t *)ev;
     Client *c;
 
-    PRINTF("Event: enter notify: win %#x\n", e->event);
-
     if (e->mode == XCB_NOTIFY_MODE_NORMAL ||
         e->mode == XCB_NOTIFY_MODE_UNGRAB) {
         if (sel && e->event == sel->win)
             return;
         if ((c = wintoclient(e->event))) {
-            raisewindow(c->frame);
-            raisewindow(c->win);
+            raiseclient(c);
             focus(c);
         }
     }
 }
 
 static void gravitynotify(xcb_generic_event_t *ev) {
-    xcb_gravity_notify_event_t *e = (xcb_gravity_notify_event_t *)ev;
-
-    PRINTF("Event: gravity notify: win %#x\n", e->event);
-    (void)e;
+    (void)ev;
 }
 
 static void keypress(xcb_generic_event_t *ev) {
@@ -199,6 +295,7 @@ static void keypress(xcb_generic_event_t *ev) {
         if (keysym == keys[i].keysym &&
             CLEANMASK(keys[i].mod) == CLEANMASK(e->state) && keys[i].func) {
             keys[i].func(&keys[i].arg);
+            stats_input(keyaction(keys[i].func), e->time);
             break;
         }
     }
@@ -207,22 +304,39 @@ static void keypress(xcb_generic_event_t *ev) {
 static void mappingnotify(xcb_generic_event_t *ev) {
     xcb_mapping_notify_event_t *e = (xcb_mapping_notify_event_t *)ev;
 
-    PRINTF("Event: mapping notify\n");
-
     if (e->request != XCB_MAPPING_MODIFIER &&
         e->request != XCB_MAPPING_KEYBOARD)
         return;
-    xcb_ungrab_key(conn, XCB_GRAB_ANY, screen->root, XCB_MOD_MASK_ANY);
+    refreshkeysyms(e);
+    if (e->request == XCB_MAPPING_MODIFIER)
+        updatenumlockmask();
+    backend_ungrab_keys();
     grabkeys();
 }
 
 static void maprequest(xcb_generic_event_t *ev) {
     xcb_map_request_event_t *e = (xcb_map_request_event_t *)ev;
 
-    PRINTF("Event: map request win %#x\n", e->window);
-
-    if (!wintoclient(e->window))
+    /* withdrawn and back, like a notification daemon's one window */
+    if (wintoclient(e->window)) {
+        backend_map(e->window);
+    } else {
+        StatsMark mark;
+        stats_start(&mark, STAT_MANAGE);
         manage(e->window);
+        trace_section(STAT_MANAGE, e->window, mark.time,
+                      stats_record(&mark));
+    }
+}
+
+static void flushproperties(void) {
+    Client *c;
+
+    for (int i = 0; i < npending_props; i++) {
+        if ((c = wintoclient(pending_props[i].win)))
+            prop_invalidate(c, pending_props[i].atom, pending_props[i].seq);
+    }
+    npending_props = 0;
 }
 
 static void propertynotify(xcb_generic_event_t *ev) {
@@ -230,28 +344,22 @@ static void propertynotify(xcb_generic_event_t *ev) {
 
     last_timestamp = e->time;
 
-#ifdef DEBUG
-    char *name = get_atom_name(e->atom);
-    PRINTF("Event: property notify: win %#x atom %s\n", e->window, name);
-    FREE(name);
-#endif
-
-    Client *c;
-    if (!(c = wintoclient(e->window)))
+    if (!prop_wanted(e->atom))
         return;
 
-    if (e->atom == XCB_ATOM_WM_NORMAL_HINTS) {
-        /* update size hints */
-        xcb_get_property_cookie_t nhc =
-            xcb_icccm_get_wm_normal_hints(conn, e->window);
-        xcb_size_hints_t sh;
-        uint8_t nhr = xcb_icccm_get_wm_normal_hints_reply(conn, nhc, &sh, NULL);
-
-        if (nhr == 1 && sh.flags & XCB_ICCCM_SIZE_HINT_P_MIN_SIZE) {
-            c->size_hints.min_width = sh.min_width;
-            c->size_hints.min_height = sh.min_height;
+    for (int i = 0; i < npending_props; i++)
+        if (pending_props[i].win == e->window &&
+            pending_props[i].atom == e->atom) {
+            pending_props[i].seq = ev->full_sequence;
+            return;
         }
-    }
+
+    if (npending_props == PENDING_MAX)
+        flushproperties();
+    pending_props[npending_props].win = e->window;
+    pending_props[npending_props].atom = e->atom;
+    pending_props[npending_props].seq = ev->full_sequence;
+    npending_props++;
 }
 
 static void requesterror(xcb_generic_event_t *ev) {
@@ -265,18 +373,12 @@ static void unmapnotify(xcb_generic_event_t *ev) {
     xcb_unmap_notify_event_t *e = (xcb_unmap_notify_event_t *)ev;
     Client *c;
 
-    PRINTF("\nEvent: unmap notify: %#x ", e->window);
-
     if ((c = wintoclient(e->window))) {
-        PRINTF("\n");
         if (c->ignore_unmap > 0) {
             c->ignore_unmap--;
-            PRINTF(" ignore unmap\n");
         } else {
             /* unmanage(c); */
         }
-    } else {
-        PRINTF("(not found)\n");
     }
 }
 
@@ -284,26 +386,63 @@ static void destroynotify(xcb_generic_event_t *ev) {
     xcb_destroy_notify_event_t *e = (xcb_destroy_notify_event_t *)ev;
     Client *c;
 
-    PRINTF("Event: destroy notify: win %#x ", e->window);
-
-    if ((c = wintoclient(e->window))) {
-        PRINTF("\n");
+    if ((c = wintoclient(e->window)))
         unmanage(c);
-    } else {
-        PRINTF("(not found)\n");
-    }
+}
+
+/* an edge dragged past the screen's by less than edge_resistance is
+ * held at the screen's */
+static int32_t resist(int32_t pos, int32_t limit) {
+    if (pos < 0 && pos > -edge_resistance)
+        return 0;
+    if (pos > limit && pos < limit + edge_resistance)
+        return limit;
+    return pos;
+}
+
+/* where a frame of length len dragged to pos along axis ends up: the
+ * edge of the two that is nearer to something snaps to it */
+static int32_t snap_move(const Client *c, int axis, int32_t pos, int32_t len,
+                         const xcb_rectangle_t *r) {
+    const int32_t limit =
+        axis == GEOM_X ? screen->width_in_pixels : screen->height_in_pixels;
+    const int32_t lead = geom_snap(axis, pos, r, snap_distance, c) - pos;
+    const int32_t trail =
+        geom_snap(axis, pos + len, r, snap_distance, c) - (pos + len);
+
+    if (lead && (!trail || abs(lead) <= abs(trail)))
+        pos += lead;
+    else
+        pos += trail;
+
+    if (resist(pos, limit) != pos)
+        return resist(pos, limit);
+    return resist(pos + len, limit) - len;
+}
+
+/* the same for the one edge a resize moves */
+static int32_t snap_edge(const Client *c, int axis, int32_t pos,
+                         const xcb_rectangle_t *r) {
+    const int32_t limit =
+        axis == GEOM_X ? screen->width_in_pixels : screen->height_in_pixels;
+
+    return resist(geom_snap(axis, pos, r, snap_distance, c), limit);
 }
 
 static void mousemotion(const xcb_button_index_t button) {
-    xcb_query_pointer_cookie_t qpc = xcb_query_pointer(conn, screen->root);
-    xcb_query_pointer_reply_t *qpr = xcb_query_pointer_reply(conn, qpc, 0);
+    /* sel may change under the events dispatched below */
+    Client *const c = sel;
+    const xcb_window_t win = c->win;
+    xcb_query_pointer_reply_t *qpr = backend_reply(backend_query_pointer());
+    if (!qpr)
+        return;
 
     xcb_cursor_t cursor;
     enum corner_t { TOP_LEFT, TOP_RIGHT, BOTTOM_LEFT, BOTTOM_RIGHT } corner;
 
     if (button == XCB_BUTTON_INDEX_3) {
-        if (qpr->root_x < sel->geom.x + (sel->geom.width / 2)) {
-            if (qpr->root_y < sel->geom.y + (sel->geom.height / 2)) {
+        if (qpr->root_x < c->geom.x + (c->geom.width / 2)) {
+            if (qpr->root_y < c->geom.y + (c->geom.height / 2)) {
                 corner = TOP_LEFT;
                 cursor = cursor_get_id(XC_TOP_LEFT);
             } else {
@@ -311,7 +450,7 @@ static void mousemotion(const xcb_button_index_t button) {
                 cursor = cursor_get_id(XC_BOTTOM_LEFT);
             }
         } else {
-            if (qpr->root_y < sel->geom.y + (sel->geom.height / 2)) {
+            if (qpr->root_y < c->geom.y + (c->geom.height / 2)) {
                 corner = TOP_RIGHT;
                 cursor = cursor_get_id(XC_TOP_RIGHT);
             } else {
@@ -328,110 +467,127 @@ static void mousemotion(const xcb_button_index_t button) {
         XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_BUTTON_RELEASE |
         XCB_EVENT_MASK_BUTTON_MOTION | XCB_EVENT_MASK_POINTER_MOTION;
 
-    xcb_grab_pointer_cookie_t gpc = xcb_grab_pointer(
-        conn, 0, screen->root, pointer_mask, XCB_GRAB_MODE_ASYNC,
-        XCB_GRAB_MODE_ASYNC, XCB_NONE, cursor, XCB_CURRENT_TIME);
-
-    xcb_grab_pointer_reply_t *gpr = xcb_grab_pointer_reply(conn, gpc, NULL);
-    if (gpr->status != XCB_GRAB_STATUS_SUCCESS) {
-        FREE(gpr);
+    if (!backend_grab_pointer(pointer_mask, cursor)) {
+        FREE(qpr);
         return;
     }
-    FREE(gpr);
-
-    int x = sel->geom.x;
-    int y = sel->geom.y;
-    int w = sel->geom.width;
-    int h = sel->geom.height;
-    int dx = 0;
-    int dy = 0;
+
+    int32_t x = c->geom.x;
+    int32_t y = c->geom.y;
+    int32_t w = c->geom.width;
+    int32_t h = c->geom.height;
+    int32_t dx = 0;
+    int32_t dy = 0;
+    /* c->geom stays as it was until the button is released */
+    const xcb_rectangle_t frame = geom_frame(c);
+    const int32_t bx = frame.width - c->geom.width;
+    const int32_t by = frame.height - c->geom.height;
+    xcb_rectangle_t r;
     xcb_time_t last_motion_time = 0;
     xcb_generic_event_t *ev;
     xcb_motion_notify_event_t *e;
-    bool ungrab = false;
+    bool ungrab = false, gone = false;
 
-    while ((ev = xcb_wait_for_event(conn)) && !ungrab) {
+    /* every event taken off the queue here is freed here, once. stop
+     * before taking one past the release, or it would be lost. */
+    while (!ungrab && !gone && (ev = backend_wait_event())) {
         switch (ev->response_type & ~0x80) {
-        case XCB_CONFIGURE_REQUEST:
-        case XCB_MAP_REQUEST:
-            maprequest(ev);
+        case XCB_BUTTON_PRESS:
+            /* another button starts no drag of its own */
             break;
         case XCB_MOTION_NOTIFY:
             e = (xcb_motion_notify_event_t *)ev;
             /* don't update more than 120 times/sec */
             if ((e->time - last_motion_time) <= (1000 / 120))
-                continue;
+                break;
             last_motion_time = e->time;
 
             if (button == XCB_BUTTON_INDEX_1) {
                 /* move */
-                x = sel->geom.x + e->root_x - qpr->root_x;
-                y = sel->geom.y + e->root_y - qpr->root_y;
-                movewin(sel->frame, x, y);
+                x = c->geom.x + e->root_x - qpr->root_x;
+                y = c->geom.y + e->root_y - qpr->root_y;
+                r = (xcb_rectangle_t){x, y, frame.width, frame.height};
+                r.x = x = snap_move(c, GEOM_X, x, frame.width, &r);
+                y = snap_move(c, GEOM_Y, y, frame.height, &r);
+                movewin(c->frame, x, y);
             } else {
-                /* resize */
+                /* resize, keeping the opposite corner anchored */
                 dx = e->root_x - qpr->root_x;
                 dy = e->root_y - qpr->root_y;
-                switch (corner) {
-                case TOP_LEFT:
-                    x = sel->geom.x + dx;
-                    y = sel->geom.y + dy;
-                    w = sel->geom.width - dx;
-                    h = sel->geom.height - dy;
-                    break;
-                case TOP_RIGHT:
-                    x = sel->geom.x;
-                    y = sel->geom.y + dy;
-                    w = sel->geom.width + dx;
-                    h = sel->geom.height - dy;
-                    break;
-                case BOTTOM_LEFT:
-                    x = sel->geom.x + dx;
-                    y = sel->geom.y;
-                    w = sel->geom.width - dx;
-                    h = sel->geom.height + dy;
-                    break;
-                case BOTTOM_RIGHT:
-                    w = sel->geom.width + dx;
-                    h = sel->geom.height + dy;
-                    break;
-                }
-                moveresize_win(sel->frame, x, y, w, h);
-                moveresize_win(sel->win, 0, 0, w, h);
+                if (corner == TOP_LEFT || corner == BOTTOM_LEFT)
+                    w = c->geom.width - dx;
+                else
+                    w = c->geom.width + dx;
+                if (corner == TOP_LEFT || corner == TOP_RIGHT)
+                    h = c->geom.height - dy;
+                else
+                    h = c->geom.height + dy;
+                /* snap the moving edges; size hints have the last word */
+                if (corner == TOP_LEFT || corner == BOTTOM_LEFT)
+                    w = frame.x + frame.width - bx -
+                        snap_edge(c, GEOM_X,
+                                  frame.x + frame.width - (w + bx), &frame);
+                else
+                    w = snap_edge(c, GEOM_X, frame.x + w + bx, &frame) -
+                        frame.x - bx;
+                if (corner == TOP_LEFT || corner == TOP_RIGHT)
+                    h = frame.y + frame.height - by -
+                        snap_edge(c, GEOM_Y,
+                                  frame.y + frame.height - (h + by), &frame);
+                else
+                    h = snap_edge(c, GEOM_Y, frame.y + h + by, &frame) -
+                        frame.y - by;
+                applysizehints(c, &w, &h);
+                x = c->geom.x;
+                y = c->geom.y;
+                if (corner == TOP_LEFT || corner == BOTTOM_LEFT)
+                    x += c->geom.width - w;
+                if (corner == TOP_LEFT || corner == TOP_RIGHT)
+                    y += c->geom.height - h;
+                moveresize_win(c->frame, x, y, w, h);
+                resizewin(c->win, w, h);
             }
+            stats_input(button == XCB_BUTTON_INDEX_1 ? "drag move"
+                                                     : "drag resize",
+                        e->time);
             break;
         case XCB_BUTTON_RELEASE:
             if (button == XCB_BUTTON_INDEX_1) { /* move */
-                sel->geom.x = x;
-                sel->geom.y = y;
+                c->geom.x = x;
+                c->geom.y = y;
             } else { /* resize */
-                sel->geom.x = x;
-                sel->geom.y = y;
-                sel->geom.width = w;
-                sel->geom.height = h;
+                c->geom.x = x;
+                c->geom.y = y;
+                c->geom.width = w;
+                c->geom.height = h;
             }
             ungrab = true;
-            setborder(sel, true);
+            setborder(c, true);
+            break;
+        default:
+            handleevent(ev);
+            /* the client was unmanaged or its workspace hidden */
+            gone = wintoclient(win) != c || c->ws != selws;
+            break;
         }
         FREE(ev);
-        xcb_flush(conn);
+        backend_flush();
     }
-    change_ewmh_flags(sel, XCB_EWMH_WM_STATE_REMOVE, EWMH_FULLSCREEN);
-    ewmh_update_wm_state(sel);
-    FREE(ev);
+    if (!gone) {
+        change_ewmh_flags(c, XCB_EWMH_WM_STATE_REMOVE, EWMH_FULLSCREEN);
+        ewmh_update_wm_state(c);
+        geom_update(c);
+    }
+    if (ungrab)
+        memo_save(c);
     FREE(qpr);
-    xcb_ungrab_pointer(conn, XCB_CURRENT_TIME);
+    backend_ungrab_pointer();
 }
 
 static void buttonpress(xcb_generic_event_t *ev) {
     xcb_button_press_event_t *e = (xcb_button_press_event_t *)ev;
     last_timestamp = e->time;
 
-    PRINTF("Event: button press: win %#x (%d,%d), root: %#x (%d,%d), child: "
-           "%#x, detail: %u, state: %u\n",
-           e->event, e->event_x, e->event_y, e->root, e->root_x, e->root_y,
-           e->child, e->detail, e->state);
-
     Client *c;
 
     if (e->event == e->root) {
@@ -441,7 +597,7 @@ static void buttonpress(xcb_generic_event_t *ev) {
                 return;
             }
         } else {
-            xcb_allow_events(conn, XCB_ALLOW_SYNC_POINTER, e->time);
+            backend_allow_events(XCB_ALLOW_SYNC_POINTER, e->time);
             return;
         }
     } else {
@@ -449,32 +605,55 @@ static void buttonpress(xcb_generic_event_t *ev) {
     }
 
     if (c && c->win != sel->win) {
-        PRINTF("buttonpress: raising win\n");
-        raisewindow(c->frame);
-        raisewindow(c->win);
+        raiseclient(c);
         focus(c);
     }
 
     /* handle any binding */
     if ((e->detail == XCB_BUTTON_INDEX_1 || e->detail == XCB_BUTTON_INDEX_3) &&
         CLEANMASK(XCB_MOD_MASK_1) == CLEANMASK(e->state)) {
-        PRINTF("buttonpress: binding\n");
         if (sel != NULL)
             mousemotion(e->detail);
     }
 
-    PRINTF("buttonpress: replay pointer\n");
-    xcb_allow_events(conn, XCB_ALLOW_REPLAY_POINTER, e->time);
+    backend_allow_events(XCB_ALLOW_REPLAY_POINTER, e->time);
+}
+
+/* run whatever was deferred while draining the event queue, and take in
+ * the property replies that came in meanwhile */
+void handlepending(void) {
+    prop_collect();
+    if (!npending_props && !npending_configs)
+        return;
+
+    StatsMark mark;
+    stats_start(&mark, STAT_PENDING);
+    flushproperties();
+    flushconfigures();
+    trace_section(STAT_PENDING, XCB_NONE, mark.time,
+                  stats_record(&mark));
 }
 
 void handleevent(xcb_generic_event_t *ev) {
-    switch (ev->response_type & ~0x80) {
+    const uint8_t type = ev->response_type & ~0x80;
+
+    /* keep deferred work ordered with everything that might depend on it */
+    if (type != XCB_PROPERTY_NOTIFY && type != XCB_CONFIGURE_REQUEST)
+        handlepending();
+
+    StatsMark mark;
+    stats_start(&mark, type < STAT_OTHER ? type : STAT_OTHER);
+
+    switch (type) {
     case XCB_BUTTON_PRESS:
         buttonpress(ev);
         break;
     case XCB_CLIENT_MESSAGE:
         clientmessage(ev);
         break;
+    case XCB_CONFIGURE_NOTIFY:
+        configurenotify(ev);
+        break;
     case XCB_CONFIGURE_REQUEST:
         configurerequest(ev);
         break;
@@ -506,4 +685,6 @@ void handleevent(xcb_generic_event_t *ev) {
         requesterror(ev);
         break;
     }
+
+    trace_event(ev, mark.time, stats_record(&mark));
 }
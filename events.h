@@ -3,5 +3,6 @@
 #define EVENTS_H
 
 void handleevent(xcb_generic_event_t *ev);
+void handlepending(void);
 
 #endif
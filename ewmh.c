@@ -3,14 +3,22 @@
 #include <unistd.h>
 #include <xcb/xcb_ewmh.h>
 #include "main.h"
+#include "backend.h"
 #include "ewmh.h"
 #include "config.h"
 #include "client.h"
+#include "workspace.h"
 #include "xcb.h"
+#include "stats.h"
 #include "log.h"
 
+/* scratch space for _NET_CLIENT_LIST rewrites */
+static xcb_window_t *client_list;
+static uint32_t client_list_size;
+
 void ewmh_setup() {
-    ewmh = malloc(sizeof(xcb_ewmh_connection_t));
+    if (!(ewmh = malloc(sizeof(xcb_ewmh_connection_t))))
+        err("can't allocate memory.");
     if ((xcb_ewmh_init_atoms_replies(ewmh, xcb_ewmh_init_atoms(conn, ewmh),
                                      NULL)) == 0)
         err("can't initialize ewmh.");
@@ -56,31 +64,44 @@ void ewmh_setup() {
         ewmh->_NET_WM_WINDOW_TYPE_DND,
         ewmh->_NET_WM_WINDOW_TYPE_NORMAL,
     };
-    xcb_ewmh_set_supported(ewmh, scrno, LENGTH(net_atoms), net_atoms);
+    backend_set_property(screen->root, XCB_PROP_MODE_REPLACE,
+                         ewmh->_NET_SUPPORTED, XCB_ATOM_ATOM, 32,
+                         LENGTH(net_atoms), net_atoms);
 
     xcb_window_t recorder = xcb_generate_id(conn);
-    xcb_create_window(conn, XCB_COPY_FROM_PARENT, recorder, screen->root, 0, 0,
-                      screen->width_in_pixels, screen->height_in_pixels, 0,
-                      XCB_WINDOW_CLASS_INPUT_ONLY, XCB_COPY_FROM_PARENT,
-                      XCB_NONE, NULL);
+    backend_create_window(recorder, screen->root,
+                          &(xcb_rectangle_t){0, 0, screen->width_in_pixels,
+                                             screen->height_in_pixels},
+                          0, XCB_WINDOW_CLASS_INPUT_ONLY, XCB_NONE, NULL);
 
     /* _NET_WM_PID */
-    xcb_ewmh_set_wm_pid(ewmh, recorder, getpid());
+    uint32_t pid = getpid();
+    backend_set_property(recorder, XCB_PROP_MODE_REPLACE, ewmh->_NET_WM_PID,
+                         XCB_ATOM_CARDINAL, 32, 1, &pid);
 
     /* _NET_WM_NAME */
-    if (java_workaround)
-        xcb_ewmh_set_wm_name(ewmh, screen->root, strlen("LG3D"), "LG3D");
-    else
-        xcb_ewmh_set_wm_name(ewmh, screen->root, strlen(__WM_NAME__),
-                             __WM_NAME__);
+    const char *name = java_workaround ? "LG3D" : __WM_NAME__;
+    backend_set_property(screen->root, XCB_PROP_MODE_REPLACE,
+                         ewmh->_NET_WM_NAME, ewmh->UTF8_STRING, 8,
+                         strlen(name), name);
 
     /* _NET_NUMBER_ODESKTOPS */
-    xcb_ewmh_set_number_of_desktops(ewmh, scrno, 10);
-    xcb_ewmh_set_current_desktop(ewmh, scrno, 0);
+    uint32_t desktops = WORKSPACES;
+    backend_set_property(screen->root, XCB_PROP_MODE_REPLACE,
+                         ewmh->_NET_NUMBER_OF_DESKTOPS, XCB_ATOM_CARDINAL, 32,
+                         1, &desktops);
+    ewmh_set_current_desktop(0);
 
     /* _NET_SUPPORTING_WM_CHECK */
-    xcb_ewmh_set_supporting_wm_check(ewmh, recorder, recorder);
-    xcb_ewmh_set_supporting_wm_check(ewmh, screen->root, recorder);
+    backend_set_property(recorder, XCB_PROP_MODE_REPLACE,
+                         ewmh->_NET_SUPPORTING_WM_CHECK, XCB_ATOM_WINDOW, 32,
+                         1, &recorder);
+    backend_set_property(screen->root, XCB_PROP_MODE_REPLACE,
+                         ewmh->_NET_SUPPORTING_WM_CHECK, XCB_ATOM_WINDOW, 32,
+                         1, &recorder);
+
+    /* clients are appended as they're managed, so start from nothing */
+    backend_delete_property(screen->root, ewmh->_NET_CLIENT_LIST);
 }
 
 void ewmh_teardown() {
@@ -88,21 +109,25 @@ void ewmh_teardown() {
     xcb_get_property_cookie_t cookie =
         xcb_get_property(conn, 0, screen->root, ewmh->_NET_SUPPORTING_WM_CHECK,
                          XCB_ATOM_WINDOW, 0, 1);
+    stats_wait(cookie.sequence);
     xcb_get_property_reply_t *pr = xcb_get_property_reply(conn, cookie, NULL);
     if (pr) {
-        if (pr->format == ewmh->_NET_SUPPORTING_WM_CHECK) {
+        if (pr->type == XCB_ATOM_WINDOW &&
+            xcb_get_property_value_length(pr) >= (int)sizeof(xcb_window_t)) {
             xcb_window_t id = *((xcb_window_t *)xcb_get_property_value(pr));
             PRINTF("deleting supporting wm check window %#x\n", id);
-            xcb_destroy_window(conn, id);
-            xcb_delete_property(conn, screen->root,
-                                ewmh->_NET_SUPPORTING_WM_CHECK);
-            xcb_delete_property(conn, screen->root, ewmh->_NET_SUPPORTED);
+            backend_destroy(id);
+            backend_delete_property(screen->root,
+                                    ewmh->_NET_SUPPORTING_WM_CHECK);
+            backend_delete_property(screen->root, ewmh->_NET_SUPPORTED);
         }
         FREE(pr);
     }
 
     xcb_ewmh_connection_wipe(ewmh);
     FREE(ewmh);
+    FREE(client_list);
+    client_list_size = 0;
 }
 
 void change_ewmh_flags(Client *c, xcb_ewmh_wm_state_action_t op,
@@ -125,12 +150,8 @@ void change_ewmh_flags(Client *c, xcb_ewmh_wm_state_action_t op,
 
 void handle_wm_state(Client *c, xcb_atom_t state,
                      xcb_ewmh_wm_state_action_t action) {
-#ifdef DEBUG
-    char *name = get_atom_name(state);
-    PRINTF("EWMH: handle_wm_state: win %#x, state: %s, action: %d %s\n", c->win,
-           name, action, c->win ? "" : "(win not found)");
-    FREE(name);
-#endif
+    PRINTF("EWMH: handle_wm_state: win %#x, state: atom %u, action: %d\n",
+           c->win, state, action);
     if (!c->win)
         return;
 
@@ -199,26 +220,25 @@ void ewmh_update_wm_state(Client *c) {
         v[i++] = ewmh->_NET_WM_STATE_ABOVE;
 
     if (i > 0)
-        xcb_change_property(conn, XCB_PROP_MODE_REPLACE, c->win,
-                            ewmh->_NET_WM_STATE, XCB_ATOM_ATOM, 32, i, v);
+        backend_set_property(c->win, XCB_PROP_MODE_REPLACE,
+                             ewmh->_NET_WM_STATE, XCB_ATOM_ATOM, 32, i, v);
     else
-        xcb_delete_property(conn, c->win, ewmh->_NET_WM_STATE);
+        backend_delete_property(c->win, ewmh->_NET_WM_STATE);
 }
 
-void ewmh_get_wm_state(Client *c) {
+/* from a request the caller sent, so it can share a round trip */
+void ewmh_get_wm_state(Client *c, unsigned int seq) {
+    xcb_get_property_reply_t *r = backend_reply(seq);
     xcb_ewmh_get_atoms_reply_t win_state;
 
-    if (xcb_ewmh_get_wm_state_reply(ewmh, xcb_ewmh_get_wm_state(ewmh, c->win),
-                                    &win_state, NULL) != 1)
+    if (xcb_ewmh_get_wm_state_from_reply(&win_state, r) != 1) {
+        free(r);
         return;
+    }
 
     for (unsigned int i = 0; i < win_state.atoms_len; i++) {
         xcb_atom_t a = win_state.atoms[i];
-#ifdef DEBUG
-        char *name = get_atom_name(a);
-        PRINTF("EWMH: state: win %#x, atom %s\n", c->win, name);
-        FREE(name);
-#endif
+        PRINTF("EWMH: state: win %#x, atom %u\n", c->win, a);
         change_ewmh_flags(c, XCB_EWMH_WM_STATE_ADD, a);
         if (a == ewmh->_NET_WM_STATE_FULLSCREEN) {
             change_ewmh_flags(c, XCB_EWMH_WM_STATE_ADD, EWMH_FULLSCREEN);
@@ -237,64 +257,109 @@ void ewmh_get_wm_state(Client *c) {
     xcb_ewmh_get_atoms_reply_wipe(&win_state);
 }
 
+/* _NET_CLIENT_LIST is in mapping order. a new client is appended to it,
+ * only a removal needs the whole list. */
+void ewmh_add_client(Client *c) {
+    backend_set_property(screen->root, XCB_PROP_MODE_APPEND,
+                         ewmh->_NET_CLIENT_LIST, XCB_ATOM_WINDOW, 32, 1,
+                         &c->win);
+}
+
 void ewmh_update_client_list(Client *list) {
     Client *t;
-    int count = 0;
+    uint32_t count = 0;
 
     for (t = list; t; t = t->next)
         count++;
 
-    if (count == 0)
+    if (count == 0) {
+        backend_delete_property(screen->root, ewmh->_NET_CLIENT_LIST);
         return;
+    }
+
+    if (count > client_list_size) {
+        xcb_window_t *wins;
+        if (!(wins = realloc(client_list, count * sizeof(xcb_window_t))))
+            err("can't allocate memory.");
+        client_list = wins;
+        client_list_size = count;
+    }
 
-    PRINTF("EWMH: client list: %d windows\n", count);
-    xcb_change_property(conn, XCB_PROP_MODE_REPLACE, screen->root,
-                        ewmh->_NET_CLIENT_LIST, XCB_ATOM_WINDOW, 32, count,
-                        list);
+    /* list is newest first */
+    uint32_t i = count;
+    for (t = list; t; t = t->next)
+        client_list[--i] = t->win;
+
+    PRINTF("EWMH: client list: %u windows\n", count);
+    backend_set_property(screen->root, XCB_PROP_MODE_REPLACE,
+                         ewmh->_NET_CLIENT_LIST, XCB_ATOM_WINDOW, 32, count,
+                         client_list);
 }
 
-void ewmh_get_wm_window_type(Client *c) {
+/* from a request the caller sent, as for the state */
+void ewmh_get_wm_window_type(Client *c, unsigned int seq) {
+    xcb_get_property_reply_t *r = backend_reply(seq);
     xcb_ewmh_get_atoms_reply_t win_type;
 
-    if (xcb_ewmh_get_wm_window_type_reply(
-            ewmh, xcb_ewmh_get_wm_window_type(ewmh, c->win), &win_type, NULL) ==
-        1) {
-        for (unsigned int i = 0; i < win_type.atoms_len; i++) {
-            xcb_atom_t a = win_type.atoms[i];
-/* (void)a; */
-#ifdef DEBUG
-            char *name = get_atom_name(a);
-            PRINTF("EWMH: window type: win %#x, atom %s\n", c->win, name);
-            FREE(name);
-#endif
-            if (a == ewmh->_NET_WM_WINDOW_TYPE_DIALOG ||
-                a == ewmh->_NET_WM_WINDOW_TYPE_SPLASH ||
-                a == ewmh->_NET_WM_WINDOW_TYPE_NOTIFICATION) {
-                teleport_client(c, Center);
-            }
-
-            if (a == ewmh->_NET_WM_WINDOW_TYPE_DESKTOP ||
-                ewmh->_NET_WM_WINDOW_TYPE_DOCK ||
-                ewmh->_NET_WM_WINDOW_TYPE_TOOLBAR ||
-                ewmh->_NET_WM_WINDOW_TYPE_MENU ||
-                ewmh->_NET_WM_WINDOW_TYPE_UTILITY ||
-                ewmh->_NET_WM_WINDOW_TYPE_DROPDOWN_MENU ||
-                ewmh->_NET_WM_WINDOW_TYPE_POPUP_MENU ||
-                ewmh->_NET_WM_WINDOW_TYPE_TOOLTIP ||
-                ewmh->_NET_WM_WINDOW_TYPE_COMBO ||
-                ewmh->_NET_WM_WINDOW_TYPE_DND ||
-                ewmh->_NET_WM_WINDOW_TYPE_NORMAL) {
-            }
+    if (xcb_ewmh_get_wm_window_type_from_reply(&win_type, r) != 1) {
+        free(r);
+        return;
+    }
+
+    /* types are listed in order of preference; the first known one wins */
+    for (unsigned int i = 0; i < win_type.atoms_len; i++) {
+        xcb_atom_t a = win_type.atoms[i];
+        PRINTF("EWMH: window type: win %#x, atom %u\n", c->win, a);
+        if (a == ewmh->_NET_WM_WINDOW_TYPE_DIALOG ||
+            a == ewmh->_NET_WM_WINDOW_TYPE_SPLASH) {
+            c->type = WINTYPE_DIALOG;
+            break;
+        } else if (a == ewmh->_NET_WM_WINDOW_TYPE_DESKTOP) {
+            c->type = WINTYPE_DESKTOP;
+            break;
+        } else if (a == ewmh->_NET_WM_WINDOW_TYPE_DOCK) {
+            c->type = WINTYPE_DOCK;
+            break;
+        } else if (a == ewmh->_NET_WM_WINDOW_TYPE_NOTIFICATION) {
+            c->type = WINTYPE_NOTIFICATION;
+            break;
+        } else if (a == ewmh->_NET_WM_WINDOW_TYPE_TOOLTIP ||
+                   a == ewmh->_NET_WM_WINDOW_TYPE_MENU ||
+                   a == ewmh->_NET_WM_WINDOW_TYPE_DROPDOWN_MENU ||
+                   a == ewmh->_NET_WM_WINDOW_TYPE_POPUP_MENU ||
+                   a == ewmh->_NET_WM_WINDOW_TYPE_COMBO ||
+                   a == ewmh->_NET_WM_WINDOW_TYPE_DND) {
+            c->type = WINTYPE_POPUP;
+            break;
+        } else if (a == ewmh->_NET_WM_WINDOW_TYPE_TOOLBAR ||
+                   a == ewmh->_NET_WM_WINDOW_TYPE_UTILITY ||
+                   a == ewmh->_NET_WM_WINDOW_TYPE_NORMAL) {
+            break;
         }
-        xcb_ewmh_get_atoms_reply_wipe(&win_type);
     }
+    xcb_ewmh_get_atoms_reply_wipe(&win_type);
 }
 
 bool ewmh_get_supporting_wm_check(xcb_window_t *win) {
     xcb_get_property_cookie_t cookie;
     cookie = xcb_ewmh_get_supporting_wm_check_unchecked(ewmh, screen->root);
+    stats_wait(cookie.sequence);
     if (xcb_ewmh_get_supporting_wm_check_reply(ewmh, cookie, win, NULL) == 0) {
         return false;
     }
     return true;
 }
+
+void ewmh_set_current_desktop(uint32_t i) {
+    backend_set_property(screen->root, XCB_PROP_MODE_REPLACE,
+                         ewmh->_NET_CURRENT_DESKTOP, XCB_ATOM_CARDINAL, 32, 1,
+                         &i);
+}
+
+/* left, right, top, bottom: the border all round */
+void ewmh_set_frame_extents(Client *c) {
+    uint32_t bw = border_width;
+    backend_set_property(c->win, XCB_PROP_MODE_REPLACE,
+                         ewmh->_NET_FRAME_EXTENTS, XCB_ATOM_CARDINAL, 32, 4,
+                         (uint32_t[]){bw, bw, bw, bw});
+}
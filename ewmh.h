@@ -7,10 +7,13 @@ void ewmh_teardown();
 void change_ewmh_flags(Client *c, xcb_ewmh_wm_state_action_t op, uint32_t mask);
 void handle_wm_state(Client *c, xcb_atom_t state,
                      xcb_ewmh_wm_state_action_t action);
-void ewmh_get_wm_state(Client *c);
+void ewmh_get_wm_state(Client *c, unsigned int seq);
 void ewmh_update_wm_state(Client *c);
+void ewmh_add_client(Client *c);
 void ewmh_update_client_list(Client *list);
-void ewmh_get_wm_window_type(Client *c);
+void ewmh_get_wm_window_type(Client *c, unsigned int seq);
 bool ewmh_get_supporting_wm_check(xcb_window_t *win);
+void ewmh_set_current_desktop(uint32_t i);
+void ewmh_set_frame_extents(Client *c);
 
 #endif
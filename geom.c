@@ -0,0 +1,629 @@
+/* See LICENSE file for copyright and license details. */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "main.h"
+#include "geom.h"
+#include "client.h"
+#include "config.h"
+#include "workspace.h"
+#include "log.h"
+
+/* every framed client's geometry, a slot each, in arrays of their own,
+ * so the batch queries below take a vector of clients at a time. slots
+ * stay packed: the last one moves into a slot given up. each array is
+ * aligned for the widest vector. */
+#define STORE_ALIGN 32
+
+/* the cells of its workspace's grid a frame is listed in, inclusive. ws
+ * is -1 while it is in none. */
+struct span {
+    int32_t ws;
+    int32_t col0, row0, col1, row1;
+};
+
+static struct {
+    int32_t *x, *y, *w, *h; /* the client's, as in geom */
+    int32_t *border;        /* on each side, 0 when none is drawn */
+    int32_t *ws;
+    struct span *span;
+    Client **client;
+    uint32_t count, size;
+} store;
+
+/* and the frames on each workspace by where they are: the screen cut
+ * into GRID_CELL squares, each listing the frames over it. a frame that
+ * reaches off the screen is listed in the edge cells nearest, so every
+ * frame is in some cell. the snapping and directional queries look only
+ * at the cells near what they ask about. */
+#define GRID_CELL 256
+
+struct cell {
+    Client **frames;
+    uint32_t count, size;
+};
+
+static struct {
+    struct cell *cells[WORKSPACES];
+    int32_t cols, rows; /* 0 until a frame is listed */
+} grid;
+
+static int32_t grid_col(int32_t x) {
+    return x < 0 ? 0 : MIN(x / GRID_CELL, grid.cols - 1);
+}
+
+static int32_t grid_row(int32_t y) {
+    return y < 0 ? 0 : MIN(y / GRID_CELL, grid.rows - 1);
+}
+
+static struct cell *grid_cell(int32_t ws, int32_t col, int32_t row) {
+    return &grid.cells[ws][row * grid.cols + col];
+}
+
+static void grid_unlist(uint32_t s) {
+    const struct span *sp = &store.span[s];
+
+    if (sp->ws < 0)
+        return;
+    for (int32_t row = sp->row0; row <= sp->row1; row++) {
+        for (int32_t col = sp->col0; col <= sp->col1; col++) {
+            struct cell *cell = grid_cell(sp->ws, col, row);
+            for (uint32_t i = 0; i < cell->count; i++) {
+                if (cell->frames[i] == store.client[s]) {
+                    cell->frames[i] = cell->frames[--cell->count];
+                    break;
+                }
+            }
+        }
+    }
+    store.span[s].ws = -1;
+}
+
+/* list slot s's frame in the cells it is over now, if they changed */
+static void grid_list(uint32_t s) {
+    const int32_t fw = store.w[s] + 2 * store.border[s];
+    const int32_t fh = store.h[s] + 2 * store.border[s];
+    struct span now;
+
+    if (!grid.cols) {
+        grid.cols = MAX(1, (screen->width_in_pixels + GRID_CELL - 1) /
+                               GRID_CELL);
+        grid.rows = MAX(1, (screen->height_in_pixels + GRID_CELL - 1) /
+                               GRID_CELL);
+    }
+    now.ws = store.ws[s] >= 0 && store.ws[s] < WORKSPACES ? store.ws[s] : -1;
+    now.col0 = grid_col(store.x[s]);
+    now.row0 = grid_row(store.y[s]);
+    now.col1 = MAX(now.col0, grid_col(store.x[s] + fw - 1));
+    now.row1 = MAX(now.row0, grid_row(store.y[s] + fh - 1));
+    if (memcmp(&now, &store.span[s], sizeof(now)) == 0)
+        return;
+
+    grid_unlist(s);
+    store.span[s] = now;
+    if (now.ws < 0)
+        return;
+    if (!grid.cells[now.ws] &&
+        !(grid.cells[now.ws] =
+              calloc(grid.cols * grid.rows, sizeof(struct cell))))
+        err("can't allocate memory.");
+    for (int32_t row = now.row0; row <= now.row1; row++) {
+        for (int32_t col = now.col0; col <= now.col1; col++) {
+            struct cell *cell = grid_cell(now.ws, col, row);
+            if (cell->count == cell->size) {
+                cell->size = cell->size ? cell->size * 2 : 8;
+                if (!(cell->frames = realloc(cell->frames,
+                                             cell->size * sizeof(Client *))))
+                    err("can't allocate memory.");
+            }
+            cell->frames[cell->count++] = store.client[s];
+        }
+    }
+}
+
+static void grid_free(void) {
+    for (int ws = 0; ws < WORKSPACES; ws++) {
+        if (!grid.cells[ws])
+            continue;
+        for (int32_t i = 0; i < grid.cols * grid.rows; i++)
+            FREE(grid.cells[ws][i].frames);
+        FREE(grid.cells[ws]);
+    }
+    grid.cols = grid.rows = 0;
+}
+
+/* whether a query of the cells from col0, row0 on meets slot s's frame
+ * first at col, row: the top left of its cells in the query's */
+static bool first(uint32_t s, int32_t col0, int32_t row0, int32_t col,
+                  int32_t row) {
+    return col == MAX(col0, store.span[s].col0) &&
+           row == MAX(row0, store.span[s].row0);
+}
+
+/* the screen changed size: cut it up again */
+void geom_resize(void) {
+    grid_free();
+    for (uint32_t s = 0; s < store.count; s++)
+        store.span[s] = (struct span){-1, 0, 0, 0, 0};
+    for (uint32_t s = 0; s < store.count; s++)
+        grid_list(s);
+}
+
+static void *store_grow(void *old, size_t elem, uint32_t size) {
+    void *p;
+
+    if (posix_memalign(&p, STORE_ALIGN, size * elem))
+        err("can't allocate memory.");
+    if (old)
+        memcpy(p, old, store.count * elem);
+    free(old);
+    return p;
+}
+
+/* c takes the next slot, when it gets a frame */
+void geom_add(Client *c) {
+    if (store.count == store.size) {
+        store.size = store.size ? store.size * 2 : 64;
+        store.x = store_grow(store.x, sizeof(int32_t), store.size);
+        store.y = store_grow(store.y, sizeof(int32_t), store.size);
+        store.w = store_grow(store.w, sizeof(int32_t), store.size);
+        store.h = store_grow(store.h, sizeof(int32_t), store.size);
+        store.border = store_grow(store.border, sizeof(int32_t), store.size);
+        store.ws = store_grow(store.ws, sizeof(int32_t), store.size);
+        store.span = store_grow(store.span, sizeof(struct span), store.size);
+        store.client = store_grow(store.client, sizeof(Client *), store.size);
+    }
+    c->slot = store.count++;
+    store.client[c->slot] = c;
+    store.span[c->slot] = (struct span){-1, 0, 0, 0, 0};
+    geom_update(c);
+}
+
+void geom_remove(Client *c) {
+    const uint32_t s = c->slot, last = --store.count;
+
+    grid_unlist(s);
+    if (s != last) {
+        store.x[s] = store.x[last];
+        store.y[s] = store.y[last];
+        store.w[s] = store.w[last];
+        store.h[s] = store.h[last];
+        store.border[s] = store.border[last];
+        store.ws[s] = store.ws[last];
+        store.span[s] = store.span[last];
+        store.client[s] = store.client[last];
+        store.client[s]->slot = s;
+    }
+    if (store.count > 0)
+        return;
+    grid_free();
+    FREE(store.x);
+    FREE(store.y);
+    FREE(store.w);
+    FREE(store.h);
+    FREE(store.border);
+    FREE(store.ws);
+    FREE(store.span);
+    FREE(store.client);
+    store.size = 0;
+}
+
+/* c's slot, after anything in geom, its workspace or its border changed.
+ * unframed clients have none. */
+void geom_update(Client *c) {
+    const uint32_t s = c->slot;
+
+    if (ISUNFRAMED(c))
+        return;
+    store.x[s] = c->geom.x;
+    store.y[s] = c->geom.y;
+    store.w[s] = c->geom.width;
+    store.h[s] = c->geom.height;
+    store.border[s] = (BWIDTH(c) - c->geom.width) / 2;
+    store.ws[s] = c->ws;
+    grid_list(s);
+}
+
+uint32_t geom_count(void) {
+    return store.count;
+}
+
+/* fit_all_in_screen()'s test for slot s: its frame would move to be on
+ * a screen of sw by sh, or the client is big enough that fit_size()
+ * could shrink it */
+static bool misfit(uint32_t s, int32_t sw, int32_t sh) {
+    const int32_t fw = store.w[s] + 2 * store.border[s];
+    const int32_t fh = store.h[s] + 2 * store.border[s];
+
+    return store.x[s] != MAX(0, MIN(store.x[s], sw - fw)) ||
+           store.y[s] != MAX(0, MIN(store.y[s], sh - fh)) ||
+           store.w[s] >= sw - 2 * border_width ||
+           store.h[s] >= sh - 2 * border_width;
+}
+
+static bool intersects(uint32_t s, const xcb_rectangle_t *r, int32_t ws) {
+    const int32_t fw = store.w[s] + 2 * store.border[s];
+    const int32_t fh = store.h[s] + 2 * store.border[s];
+
+    return store.ws[s] == ws && store.x[s] < r->x + r->width &&
+           r->x < store.x[s] + fw && store.y[s] < r->y + r->height &&
+           r->y < store.y[s] + fh;
+}
+
+/* the vector parts of the batch queries: whole vectors of slots from
+ * the first, with what they find put in out. each returns the first slot
+ * left for the scalar test. */
+#if defined(__AVX2__) || defined(__SSE2__)
+/* the clients in the slots from s whose bits are set */
+static void found(int bits, uint32_t s, Client **out, uint32_t *n) {
+    for (; bits; bits >>= 1, s++)
+        if (bits & 1)
+            out[(*n)++] = store.client[s];
+}
+#endif
+
+#ifdef __AVX2__
+/* eight slots at a time */
+static uint32_t misfit_vectors(int32_t sw, int32_t sh, Client **out,
+                               uint32_t *n) {
+    const __m256i vsw = _mm256_set1_epi32(sw), vsh = _mm256_set1_epi32(sh);
+    const __m256i big_w = _mm256_set1_epi32(sw - 2 * border_width - 1);
+    const __m256i big_h = _mm256_set1_epi32(sh - 2 * border_width - 1);
+    const __m256i zero = _mm256_setzero_si256();
+    uint32_t s;
+
+    for (s = 0; s + 8 <= store.count; s += 8) {
+        const __m256i x = _mm256_load_si256((const __m256i *)(store.x + s));
+        const __m256i y = _mm256_load_si256((const __m256i *)(store.y + s));
+        const __m256i w = _mm256_load_si256((const __m256i *)(store.w + s));
+        const __m256i h = _mm256_load_si256((const __m256i *)(store.h + s));
+        const __m256i b2 = _mm256_slli_epi32(
+            _mm256_load_si256((const __m256i *)(store.border + s)), 1);
+        const __m256i cx = _mm256_max_epi32(
+            zero, _mm256_min_epi32(x, _mm256_sub_epi32(
+                                          vsw, _mm256_add_epi32(w, b2))));
+        const __m256i cy = _mm256_max_epi32(
+            zero, _mm256_min_epi32(y, _mm256_sub_epi32(
+                                          vsh, _mm256_add_epi32(h, b2))));
+        const __m256i stays =
+            _mm256_and_si256(_mm256_cmpeq_epi32(cx, x),
+                             _mm256_cmpeq_epi32(cy, y));
+        const __m256i fits =
+            _mm256_and_si256(_mm256_cmpgt_epi32(big_w, w),
+                             _mm256_cmpgt_epi32(big_h, h));
+        const __m256i ok = _mm256_and_si256(stays, fits);
+        found(~_mm256_movemask_ps(_mm256_castsi256_ps(ok)) & 0xff, s, out, n);
+    }
+    return s;
+}
+
+static uint32_t intersect_vectors(const xcb_rectangle_t *r, int32_t ws,
+                                  Client **out, uint32_t *n) {
+    const __m256i vws = _mm256_set1_epi32(ws);
+    const __m256i left = _mm256_set1_epi32(r->x);
+    const __m256i top = _mm256_set1_epi32(r->y);
+    const __m256i right = _mm256_set1_epi32(r->x + r->width);
+    const __m256i bottom = _mm256_set1_epi32(r->y + r->height);
+    uint32_t s;
+
+    for (s = 0; s + 8 <= store.count; s += 8) {
+        const __m256i x = _mm256_load_si256((const __m256i *)(store.x + s));
+        const __m256i y = _mm256_load_si256((const __m256i *)(store.y + s));
+        const __m256i b2 = _mm256_slli_epi32(
+            _mm256_load_si256((const __m256i *)(store.border + s)), 1);
+        const __m256i x2 = _mm256_add_epi32(
+            _mm256_add_epi32(
+                x, _mm256_load_si256((const __m256i *)(store.w + s))),
+            b2);
+        const __m256i y2 = _mm256_add_epi32(
+            _mm256_add_epi32(
+                y, _mm256_load_si256((const __m256i *)(store.h + s))),
+            b2);
+        __m256i hit = _mm256_cmpeq_epi32(
+            _mm256_load_si256((const __m256i *)(store.ws + s)), vws);
+        hit = _mm256_and_si256(hit, _mm256_cmpgt_epi32(right, x));
+        hit = _mm256_and_si256(hit, _mm256_cmpgt_epi32(x2, left));
+        hit = _mm256_and_si256(hit, _mm256_cmpgt_epi32(bottom, y));
+        hit = _mm256_and_si256(hit, _mm256_cmpgt_epi32(y2, top));
+        found(_mm256_movemask_ps(_mm256_castsi256_ps(hit)), s, out, n);
+    }
+    return s;
+}
+#elif defined(__SSE2__)
+/* four slots at a time. sse2 has no 32-bit min or max, so compare and
+ * select. */
+static __m128i min4(__m128i a, __m128i b) {
+    const __m128i over = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(over, b), _mm_andnot_si128(over, a));
+}
+
+static __m128i max4(__m128i a, __m128i b) {
+    const __m128i over = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(over, a), _mm_andnot_si128(over, b));
+}
+
+static uint32_t misfit_vectors(int32_t sw, int32_t sh, Client **out,
+                               uint32_t *n) {
+    const __m128i vsw = _mm_set1_epi32(sw), vsh = _mm_set1_epi32(sh);
+    const __m128i big_w = _mm_set1_epi32(sw - 2 * border_width - 1);
+    const __m128i big_h = _mm_set1_epi32(sh - 2 * border_width - 1);
+    const __m128i zero = _mm_setzero_si128();
+    uint32_t s;
+
+    for (s = 0; s + 4 <= store.count; s += 4) {
+        const __m128i x = _mm_load_si128((const __m128i *)(store.x + s));
+        const __m128i y = _mm_load_si128((const __m128i *)(store.y + s));
+        const __m128i w = _mm_load_si128((const __m128i *)(store.w + s));
+        const __m128i h = _mm_load_si128((const __m128i *)(store.h + s));
+        const __m128i b2 = _mm_slli_epi32(
+            _mm_load_si128((const __m128i *)(store.border + s)), 1);
+        const __m128i cx =
+            max4(zero, min4(x, _mm_sub_epi32(vsw, _mm_add_epi32(w, b2))));
+        const __m128i cy =
+            max4(zero, min4(y, _mm_sub_epi32(vsh, _mm_add_epi32(h, b2))));
+        const __m128i stays = _mm_and_si128(_mm_cmpeq_epi32(cx, x),
+                                            _mm_cmpeq_epi32(cy, y));
+        const __m128i fits = _mm_and_si128(_mm_cmpgt_epi32(big_w, w),
+                                           _mm_cmpgt_epi32(big_h, h));
+        const __m128i ok = _mm_and_si128(stays, fits);
+        found(~_mm_movemask_ps(_mm_castsi128_ps(ok)) & 0xf, s, out, n);
+    }
+    return s;
+}
+
+static uint32_t intersect_vectors(const xcb_rectangle_t *r, int32_t ws,
+                                  Client **out, uint32_t *n) {
+    const __m128i vws = _mm_set1_epi32(ws);
+    const __m128i left = _mm_set1_epi32(r->x);
+    const __m128i top = _mm_set1_epi32(r->y);
+    const __m128i right = _mm_set1_epi32(r->x + r->width);
+    const __m128i bottom = _mm_set1_epi32(r->y + r->height);
+    uint32_t s;
+
+    for (s = 0; s + 4 <= store.count; s += 4) {
+        const __m128i x = _mm_load_si128((const __m128i *)(store.x + s));
+        const __m128i y = _mm_load_si128((const __m128i *)(store.y + s));
+        const __m128i b2 = _mm_slli_epi32(
+            _mm_load_si128((const __m128i *)(store.border + s)), 1);
+        const __m128i x2 = _mm_add_epi32(
+            _mm_add_epi32(x, _mm_load_si128((const __m128i *)(store.w + s))),
+            b2);
+        const __m128i y2 = _mm_add_epi32(
+            _mm_add_epi32(y, _mm_load_si128((const __m128i *)(store.h + s))),
+            b2);
+        __m128i hit = _mm_cmpeq_epi32(
+            _mm_load_si128((const __m128i *)(store.ws + s)), vws);
+        hit = _mm_and_si128(hit, _mm_cmpgt_epi32(right, x));
+        hit = _mm_and_si128(hit, _mm_cmpgt_epi32(x2, left));
+        hit = _mm_and_si128(hit, _mm_cmpgt_epi32(bottom, y));
+        hit = _mm_and_si128(hit, _mm_cmpgt_epi32(y2, top));
+        found(_mm_movemask_ps(_mm_castsi128_ps(hit)), s, out, n);
+    }
+    return s;
+}
+#else
+/* no vectors: the scalar tests take every slot */
+static uint32_t misfit_vectors(int32_t sw, int32_t sh, Client **out,
+                               uint32_t *n) {
+    (void)sw;
+    (void)sh;
+    (void)out;
+    (void)n;
+    return 0;
+}
+
+static uint32_t intersect_vectors(const xcb_rectangle_t *r, int32_t ws,
+                                  Client **out, uint32_t *n) {
+    (void)r;
+    (void)ws;
+    (void)out;
+    (void)n;
+    return 0;
+}
+#endif
+
+/* the clients fit_all_in_screen() has to look at when the screen is sw
+ * by sh, into out, which has room for geom_count(). returns how many. */
+uint32_t geom_misfits(int32_t sw, int32_t sh, Client **out) {
+    uint32_t n = 0;
+
+    for (uint32_t s = misfit_vectors(sw, sh, out, &n); s < store.count; s++)
+        if (misfit(s, sw, sh))
+            out[n++] = store.client[s];
+    return n;
+}
+
+/* the clients on ws whose frames share some of r, into out, which has
+ * room for geom_count(). returns how many. */
+uint32_t geom_intersecting(const xcb_rectangle_t *r, unsigned int ws,
+                           Client **out) {
+    uint32_t n = 0;
+
+    for (uint32_t s = intersect_vectors(r, ws, out, &n); s < store.count;
+         s++)
+        if (intersects(s, r, ws))
+            out[n++] = store.client[s];
+    return n;
+}
+
+/* the frame as it sits on screen, borders included */
+xcb_rectangle_t geom_frame(const Client *c) {
+    return (xcb_rectangle_t){c->geom.x, c->geom.y, BWIDTH(c), BHEIGHT(c)};
+}
+
+/* how far apart two spans on the same axis are, 0 if they overlap */
+static int32_t gap(int32_t a, int32_t alen, int32_t b, int32_t blen) {
+    if (b >= a + alen)
+        return b - (a + alen);
+    if (a >= b + blen)
+        return a - (b + blen);
+    return 0;
+}
+
+/* the frame next to c in direction (Left, Right, Top or Bottom): its
+ * centre has to lie that way. the distance that way counts once, being
+ * out of line counts twice, so a window straight across beats a closer
+ * one off to the side. ties go to the one higher in the stack.
+ *
+ * the search takes in a cell of the grid more that way and to either
+ * side each round. a frame it hasn't met is at least that far that way
+ * or out of line, so it stops once the best found scores less. */
+Client *geom_neighbor(const Client *c, int direction) {
+    const xcb_rectangle_t r = geom_frame(c);
+    const int32_t cx = r.x + r.width / 2, cy = r.y + r.height / 2;
+    int32_t seen[4] = {0, 0, -1, -1}; /* the cells met, none yet */
+    Client *best = NULL;
+    int64_t best_score = INT64_MAX;
+
+    if (direction != Left && direction != Right && direction != Top &&
+        direction != Bottom)
+        return NULL;
+    if (selws >= WORKSPACES || !grid.cells[selws])
+        return NULL;
+
+    for (int32_t reach = GRID_CELL;; reach += GRID_CELL) {
+        int32_t x0 = r.x - reach, x1 = r.x + r.width - 1 + reach;
+        int32_t y0 = r.y - reach, y1 = r.y + r.height - 1 + reach;
+        int32_t cells[4];
+
+        if (direction == Left || direction == Right) {
+            x0 = direction == Left ? cx - reach + 1 : cx;
+            x1 = direction == Left ? cx : cx + reach - 1;
+        } else {
+            y0 = direction == Top ? cy - reach + 1 : cy;
+            y1 = direction == Top ? cy : cy + reach - 1;
+        }
+        cells[0] = grid_col(x0);
+        cells[1] = grid_row(y0);
+        cells[2] = grid_col(x1);
+        cells[3] = grid_row(y1);
+        if (memcmp(cells, seen, sizeof(cells)) == 0)
+            break;
+
+        for (int32_t row = cells[1]; row <= cells[3]; row++) {
+            for (int32_t col = cells[0]; col <= cells[2]; col++) {
+                const struct cell *cell;
+
+                if (col >= seen[0] && col <= seen[2] && row >= seen[1] &&
+                    row <= seen[3])
+                    continue;
+                cell = grid_cell(selws, col, row);
+                for (uint32_t i = 0; i < cell->count; i++) {
+                    Client *t = cell->frames[i];
+                    const uint32_t s = t->slot;
+                    const int32_t b2 = 2 * store.border[s];
+                    const int32_t fw = store.w[s] + b2;
+                    const int32_t fh = store.h[s] + b2;
+                    const int32_t dx = store.x[s] + fw / 2 - cx;
+                    const int32_t dy = store.y[s] + fh / 2 - cy;
+                    int32_t along, across;
+
+                    if (t == c)
+                        continue;
+                    if (direction == Left || direction == Right) {
+                        along = direction == Left ? -dx : dx;
+                        across = gap(r.y, r.height, store.y[s], fh);
+                    } else {
+                        along = direction == Top ? -dy : dy;
+                        across = gap(r.x, r.width, store.x[s], fw);
+                    }
+                    if (along <= 0)
+                        continue;
+
+                    const int64_t score =
+                        (int64_t)along + 2 * (int64_t)across;
+                    if (score < best_score ||
+                        (score == best_score && t->stacked > best->stacked)) {
+                        best = t;
+                        best_score = score;
+                    }
+                }
+            }
+        }
+        memcpy(seen, cells, sizeof(seen));
+        if (best_score < reach)
+            break;
+    }
+    return best;
+}
+
+/* e, if it is nearer pos than the best so far, or as near and lower */
+static void nearer(int32_t e, int32_t pos, int32_t *best, int32_t *best_dist) {
+    const int32_t d = abs(e - pos);
+
+    if (d < *best_dist || (d == *best_dist && e < *best)) {
+        *best = e;
+        *best_dist = d;
+    }
+}
+
+/* the edge within dist of pos, on r's side of the screen: the screen's,
+ * or one of a shown frame other than skip's that covers some of r's rows
+ * (or columns, for GEOM_Y). pos if none. only the cells within dist of
+ * pos, over r, are looked at. */
+int32_t geom_snap(int axis, int32_t pos, const xcb_rectangle_t *r,
+                  int32_t dist, const Client *skip) {
+    const int32_t from = axis == GEOM_X ? r->y : r->x;
+    const int32_t to = from + (axis == GEOM_X ? r->height : r->width);
+    const int32_t sw = screen->width_in_pixels;
+    const int32_t sh = screen->height_in_pixels;
+    int32_t best = INT32_MIN, best_dist = dist + 1;
+    int32_t col0, col1, row0, row1;
+
+    if (dist <= 0)
+        return pos;
+    if (from < (axis == GEOM_X ? sh : sw) && 0 < to) {
+        nearer(0, pos, &best, &best_dist);
+        nearer(axis == GEOM_X ? sw : sh, pos, &best, &best_dist);
+    }
+    if (selws >= WORKSPACES || !grid.cells[selws] || to <= from)
+        return best_dist <= dist ? best : pos;
+
+    /* a frame with an edge in reach has a pixel in [pos - dist - 1,
+     * pos + dist] */
+    if (axis == GEOM_X) {
+        col0 = grid_col(pos - dist - 1);
+        col1 = grid_col(pos + dist);
+        row0 = grid_row(from);
+        row1 = grid_row(to - 1);
+    } else {
+        col0 = grid_col(from);
+        col1 = grid_col(to - 1);
+        row0 = grid_row(pos - dist - 1);
+        row1 = grid_row(pos + dist);
+    }
+    for (int32_t row = row0; row <= row1; row++) {
+        for (int32_t col = col0; col <= col1; col++) {
+            const struct cell *cell = grid_cell(selws, col, row);
+            for (uint32_t i = 0; i < cell->count; i++) {
+                const uint32_t s = cell->frames[i]->slot;
+                const int32_t b2 = 2 * store.border[s];
+                int32_t a, len, other, other_len;
+
+                if (cell->frames[i] == skip || !first(s, col0, row0, col, row))
+                    continue;
+                if (axis == GEOM_X) {
+                    a = store.x[s];
+                    len = store.w[s] + b2;
+                    other = store.y[s];
+                    other_len = store.h[s] + b2;
+                } else {
+                    a = store.y[s];
+                    len = store.h[s] + b2;
+                    other = store.x[s];
+                    other_len = store.w[s] + b2;
+                }
+                if (other >= to || from >= other + other_len)
+                    continue;
+                nearer(a, pos, &best, &best_dist);
+                nearer(a + len, pos, &best, &best_dist);
+            }
+        }
+    }
+    return best_dist <= dist ? best : pos;
+}
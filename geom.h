@@ -0,0 +1,23 @@
+/* See LICENSE file for copyright and license details. */
+#ifndef GEOM_H
+#define GEOM_H
+
+#include <stdbool.h>
+#include <xcb/xcb.h>
+
+enum { GEOM_X, GEOM_Y };
+
+void geom_add(Client *c);
+void geom_remove(Client *c);
+void geom_update(Client *c);
+void geom_resize(void);
+uint32_t geom_count(void);
+uint32_t geom_misfits(int32_t sw, int32_t sh, Client **out);
+uint32_t geom_intersecting(const xcb_rectangle_t *r, unsigned int ws,
+                           Client **out);
+xcb_rectangle_t geom_frame(const Client *c);
+Client *geom_neighbor(const Client *c, int direction);
+int32_t geom_snap(int axis, int32_t pos, const xcb_rectangle_t *r,
+                  int32_t dist, const Client *skip);
+
+#endif
@@ -2,6 +2,7 @@
 #include <X11/keysym.h>
 #include <X11/XF86keysym.h>
 #include "main.h"
+#include "backend.h"
 #include "events.h"
 #include "cursor.h"
 #include "keys.h"
@@ -17,40 +18,44 @@ const Rule rules[RULE_MAX] = {
     {"firefox", 0, false, false},
 };
 
-static char terminal[] = "urxvt";
-static char terminal2[] = "termite";
-static char browser[] = "chromium";
-static char browser2[] = "firefox";
-static char launcher[] = "rofi -show run";
-static char mpctoggle[] = "mpc -q toggle";
-static char mpcseekf[] = "mpc -q seek +30";
-static char mpcseekb[] = "mpc -q seek -30";
-static char mpcnext[] = "mpc -q next";
-static char mpcprev[] = "mpc -q prev";
-static char volup[] = "amixer -q set Master 3%+ unmute";
-static char voldown[] = "amixer -q set Master 3%- unmute";
-static char voltoggle[] = "amixer -q set Master toggle";
+/* command         startup notification  dir   env   memory limit */
+static const Command terminal = {"urxvt", true, NULL, NULL, 0};
+static const Command terminal2 = {"termite", false, NULL, NULL, 0};
+static const Command browser = {"chromium", false, NULL, NULL, 0};
+static const Command browser2 = {"firefox", false, NULL, NULL, 0};
+static const Command launcher = {"rofi -show run", false, NULL, NULL, 0};
+static const Command mpctoggle = {"mpc -q toggle", false, NULL, NULL, 0};
+static const Command mpcseekf = {"mpc -q seek +30", false, NULL, NULL, 0};
+static const Command mpcseekb = {"mpc -q seek -30", false, NULL, NULL, 0};
+static const Command mpcnext = {"mpc -q next", false, NULL, NULL, 0};
+static const Command mpcprev = {"mpc -q prev", false, NULL, NULL, 0};
+static const Command volup = {
+    "amixer -q set Master 3%+ unmute", false, NULL, NULL, 0};
+static const Command voldown = {
+    "amixer -q set Master 3%- unmute", false, NULL, NULL, 0};
+static const Command voltoggle = {
+    "amixer -q set Master toggle", false, NULL, NULL, 0};
 
 #define MOD XCB_MOD_MASK_4
 #define SHIFT XCB_MOD_MASK_SHIFT
 #define CTRL XCB_MOD_MASK_CONTROL
 Key keys[KEY_MAX] = {
     /* modifier     key                       function       argument */
-    {MOD, XK_Return, spawn, {.com = terminal}},
-    {MOD, XK_t, spawn, {.com = terminal2}},
-    {MOD, XK_w, spawn, {.com = browser}},
-    {MOD, XK_e, spawn, {.com = browser2}},
-    {MOD, XK_space, spawn, {.com = launcher}},
-    {MOD, XK_p, spawn, {.com = mpctoggle}},
-    {XCB_NONE, XK_Pause, spawn, {.com = mpcseekf}},
-    {XCB_NONE, XK_Print, spawn, {.com = mpcseekb}},
-    {MOD, XK_o, spawn, {.com = mpcnext}},
-    {MOD, XK_i, spawn, {.com = mpcprev}},
-    {XCB_NONE, XK_F2, spawn, {.com = volup}},
-    {XCB_NONE, XK_F1, spawn, {.com = voldown}},
-    {XCB_NONE, XF86XK_AudioRaiseVolume, spawn, {.com = volup}},
-    {XCB_NONE, XF86XK_AudioLowerVolume, spawn, {.com = voldown}},
-    {XCB_NONE, XF86XK_AudioMute, spawn, {.com = voltoggle}},
+    {MOD, XK_Return, spawn, {.cmd = &terminal}},
+    {MOD, XK_t, spawn, {.cmd = &terminal2}},
+    {MOD, XK_w, spawn, {.cmd = &browser}},
+    {MOD, XK_e, spawn, {.cmd = &browser2}},
+    {MOD, XK_space, spawn, {.cmd = &launcher}},
+    {MOD, XK_p, spawn, {.cmd = &mpctoggle}},
+    {XCB_NONE, XK_Pause, spawn, {.cmd = &mpcseekf}},
+    {XCB_NONE, XK_Print, spawn, {.cmd = &mpcseekb}},
+    {MOD, XK_o, spawn, {.cmd = &mpcnext}},
+    {MOD, XK_i, spawn, {.cmd = &mpcprev}},
+    {XCB_NONE, XK_F2, spawn, {.cmd = &volup}},
+    {XCB_NONE, XK_F1, spawn, {.cmd = &voldown}},
+    {XCB_NONE, XF86XK_AudioRaiseVolume, spawn, {.cmd = &volup}},
+    {XCB_NONE, XF86XK_AudioLowerVolume, spawn, {.cmd = &voldown}},
+    {XCB_NONE, XF86XK_AudioMute, spawn, {.cmd = &voltoggle}},
     {MOD | SHIFT, XK_j, resize, {.i = GrowHeight}},
     {MOD | SHIFT, XK_l, resize, {.i = GrowWidth}},
     {MOD | SHIFT, XK_k, resize, {.i = ShrinkHeight}},
@@ -92,26 +97,60 @@ Key keys[KEY_MAX] = {
     {MOD | SHIFT, XK_u, maximize_half, {.i = Right}},
     {MOD | SHIFT, XK_b, maximize_half, {.i = Bottom}},
     {MOD | SHIFT, XK_n, maximize_half, {.i = Top}},
+    {MOD, XK_Left, focusdir, {.i = Left}},
+    {MOD, XK_Right, focusdir, {.i = Right}},
+    {MOD, XK_Up, focusdir, {.i = Top}},
+    {MOD, XK_Down, focusdir, {.i = Bottom}},
+    {MOD | SHIFT, XK_Left, swapdir, {.i = Left}},
+    {MOD | SHIFT, XK_Right, swapdir, {.i = Right}},
+    {MOD | SHIFT, XK_Up, swapdir, {.i = Top}},
+    {MOD | SHIFT, XK_Down, swapdir, {.i = Bottom}},
 };
 
+/* the keyboard mapping is fetched once and then follows MappingNotify,
+ * so a key press doesn't cost a round trip */
+void refreshkeysyms(xcb_mapping_notify_event_t *e) {
+    backend_refresh_keymap(e);
+}
+
+void freekeysyms(void) {
+    backend_free_keymap();
+}
+
 xcb_keycode_t *getkeycodes(xcb_keysym_t keysym) {
-    xcb_key_symbols_t *keysyms;
-    if (!(keysyms = xcb_key_symbols_alloc(conn)))
-        err("can't get keycode.");
-    xcb_keycode_t *keycode = xcb_key_symbols_get_keycode(keysyms, keysym);
-    xcb_key_symbols_free(keysyms);
-    return keycode;
+    return backend_keycodes(keysym);
 }
 
 xcb_keysym_t getkeysym(xcb_keycode_t keycode) {
-    xcb_key_symbols_t *keysyms;
-
-    if (!(keysyms = xcb_key_symbols_alloc(conn)))
-        err("can't get keysym.");
+    return backend_keysym(keycode);
+}
 
-    xcb_keysym_t keysym = xcb_key_symbols_get_keysym(keysyms, keycode, 0);
-    xcb_key_symbols_free(keysyms);
-    return keysym;
+/* what a binding does, for the input latency stats */
+const char *keyaction(void (*func)(const Arg *)) {
+    static const struct {
+        void (*func)(const Arg *);
+        const char *name;
+    } actions[] = {
+        {spawn, "spawn"},
+        {resize, "resize"},
+        {cycleclients, "cycle"},
+        {focusdir, "focus direction"},
+        {swapdir, "swap direction"},
+        {teleport, "teleport"},
+        {maximize, "maximize"},
+        {maximizeaxis, "maximize axis"},
+        {maximize_half, "maximize half"},
+        {killselected, "kill"},
+        {selectrws, "workspace"},
+        {selectws, "workspace"},
+        {sendtows, "send to workspace"},
+        {move, "move"},
+    };
+
+    for (int i = 0; i < LENGTH(actions); i++)
+        if (actions[i].func == func)
+            return actions[i].name;
+    return "other";
 }
 
 void grabkeys(void) {
@@ -121,16 +160,14 @@ void grabkeys(void) {
     modifiers[2] = numlockmask;
     modifiers[3] = numlockmask | XCB_MOD_MASK_LOCK;
 
-    xcb_ungrab_key(conn, XCB_GRAB_ANY, screen->root, XCB_MOD_MASK_ANY);
+    backend_ungrab_keys();
 
     for (int i = 0; i < LENGTH(keys); ++i) {
         xcb_keycode_t *keycode = getkeycodes(keys[i].keysym);
 
         for (int j = 0; keycode[j] != XCB_NO_SYMBOL; j++) {
             for (int k = 0; k < LENGTH(modifiers); k++) {
-                xcb_grab_key(conn, 1, screen->root, keys[i].mod | modifiers[k],
-                             keycode[j], XCB_GRAB_MODE_ASYNC,
-                             XCB_GRAB_MODE_ASYNC);
+                backend_grab_key(keys[i].mod | modifiers[k], keycode[j]);
             }
         }
         FREE(keycode);
@@ -140,8 +177,8 @@ void grabkeys(void) {
 void updatenumlockmask(void) {
     numlockmask = 0;
 
-    xcb_get_modifier_mapping_reply_t *mmr = xcb_get_modifier_mapping_reply(
-        conn, xcb_get_modifier_mapping(conn), NULL);
+    xcb_get_modifier_mapping_reply_t *mmr =
+        backend_reply(backend_get_modifier_mapping());
     if (!mmr)
         err("mod map mmr");
 
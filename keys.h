@@ -4,6 +4,9 @@
 
 xcb_keycode_t *getkeycodes(xcb_keysym_t keysym);
 xcb_keysym_t getkeysym(xcb_keycode_t keycode);
+void refreshkeysyms(xcb_mapping_notify_event_t *e);
+void freekeysyms(void);
+const char *keyaction(void (*func)(const Arg *));
 void grabkeys(void);
 void updatenumlockmask(void);
 
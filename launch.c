@@ -1,39 +1,648 @@
 /* See LICENSE file for copyright and license details. */
+#include <sys/resource.h>
+#include <sys/socket.h>
 #include <sys/wait.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
 #include <string.h>
 #include <unistd.h>
 #include "main.h"
+#include "backend.h"
 #include "log.h"
+#include "config.h"
 #include "cursor.h"
+#include "workspace.h"
+#include "stats.h"
 #include "launch.h"
 
-void launch_application(const char *cmd, const bool notify) {
-    SnLauncherContext *context;
+#define STARTUP_ID_ENV "DESKTOP_STARTUP_ID="
 
-    if (notify) {
-        context = sn_launcher_context_new(sndisplay, scrno);
-        sn_launcher_context_set_name(context, __WM_NAME__);
-        sn_launcher_context_set_description(context, "launch application");
-        sn_launcher_context_initiate(context, __WM_NAME__, cmd, last_timestamp);
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+extern char **environ;
+
+/* one message each way over a SOCK_SEQPACKET socketpair */
+struct launch_request {
+    uint32_t seq;
+    uint64_t mem_limit;
+    char id[256];
+    char cmd[512];
+    char dir[256];
+    char env[256];
+};
+
+enum { LAUNCH_SPAWNED, LAUNCH_FAILED, LAUNCH_EXITED };
+
+struct launch_report {
+    int32_t type;
+    int32_t pid;
+    int32_t status;
+    uint32_t seq;
+};
+
+/* launches still waiting for their first window, oldest overwritten.
+ * one that hasn't mapped a window after LAUNCH_TIMEOUT is given up on. */
+#define LAUNCH_MAX 16
+#define LAUNCH_TIMEOUT (30 * 1000000000ull)
+
+static struct {
+    uint32_t seq; /* 0 if the slot is free */
+    pid_t pid;    /* 0 until known */
+    unsigned int ws;
+    char id[256]; /* startup id, empty without notification */
+    const char *com;
+    xcb_timestamp_t key_time; /* server time of the key that launched it */
+    uint64_t launched;        /* stats_now() at each step, 0 until then */
+    uint64_t mapped;
+    uint64_t focused;
+    xcb_window_t win; /* first window matched to it */
+} launches[LAUNCH_MAX];
+static uint32_t launch_seq;
 
-        PRINTF("launch_application: startup id: %s\n",
-               sn_launcher_context_get_startup_id(context));
+/* rolling latency samples per command, in microseconds */
+#define LATENCY_MAX 32
+#define LATENCY_SAMPLES 64
+
+static struct {
+    const char *com;
+    uint32_t maps;
+    uint32_t focuses;
+    uint32_t map_us[LATENCY_SAMPLES];
+    uint32_t focus_us[LATENCY_SAMPLES];
+} latency[LATENCY_MAX];
+
+static int helper_fd = -1;
+static int helper_sigpipe[2];
+
+/* pids sigchld() reaped, for launch_reap(). any past LAUNCH_MAX between
+ * two calls are left to the timeout. */
+static volatile pid_t reaped[LAUNCH_MAX];
+static volatile sig_atomic_t nreaped;
+
+/* children are never waited for in the event loop; reap them as they exit */
+static void sigchld(int sig) {
+    (void)sig;
+    const int saved_errno = errno;
+    pid_t pid;
+    while ((pid = waitpid(-1, NULL, WNOHANG)) > 0)
+        if (nreaped < LAUNCH_MAX)
+            reaped[nreaped++] = pid;
+    errno = saved_errno;
+}
+
+static void helper_sigchld(int sig) {
+    (void)sig;
+    const int saved_errno = errno;
+    if (write(helper_sigpipe[1], "", 1) == -1) {
+        /* a wakeup is already pending */
     }
+    errno = saved_errno;
+}
 
-    if (fork() == 0) {
-        setsid();
-        if (fork() == 0) {
-            if (notify)
-                sn_launcher_context_setup_child_process(context);
-            execl("/bin/sh", "/bin/sh", "-c", cmd, (void *)NULL);
-            err("execl failed: %s\n", cmd);
+static void helper_report(int fd, int32_t type, pid_t pid, int status,
+                          uint32_t seq) {
+    const struct launch_report rep = {type, pid, status, seq};
+    if (send(fd, &rep, sizeof(rep), MSG_NOSIGNAL) == -1)
+        _exit(EXIT_FAILURE);
+}
+
+/* runs in the forked child of the helper */
+static void helper_exec(struct launch_request *req) {
+    signal(SIGUSR1, SIG_DFL);
+    signal(SIGUSR2, SIG_DFL);
+    setsid();
+    if (req->dir[0] && chdir(req->dir) == -1)
+        fprintf(stderr, __WM_NAME__ ": chdir %s: %s\n", req->dir,
+                strerror(errno));
+    if (req->mem_limit) {
+        const struct rlimit rl = {req->mem_limit, req->mem_limit};
+        setrlimit(RLIMIT_AS, &rl);
+    }
+    if (req->id[0])
+        setenv("DESKTOP_STARTUP_ID", req->id, 1);
+    if (req->env[0])
+        putenv(req->env);
+    execl("/bin/sh", "/bin/sh", "-c", req->cmd, (void *)NULL);
+    _exit(127);
+}
+
+/* the helper forks and execs on the window manager's behalf, and reports
+ * each pid and exit status back. it exits once the socket closes. */
+static void helper_main(int fd) {
+    struct sigaction sa = {.sa_handler = helper_sigchld,
+                           .sa_flags = SA_RESTART | SA_NOCLDSTOP};
+    struct launch_request req;
+    int status;
+    pid_t pid;
+    char buf[64];
+
+    if (pipe(helper_sigpipe) == -1)
+        _exit(EXIT_FAILURE);
+    fcntl(helper_sigpipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(helper_sigpipe[1], F_SETFL, O_NONBLOCK);
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGCHLD, &sa, NULL);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGHUP, SIG_DFL);
+    /* stats and trace dumps are the window manager's business */
+    signal(SIGUSR1, SIG_IGN);
+    signal(SIGUSR2, SIG_IGN);
+
+    for (;;) {
+        struct pollfd fds[] = {{fd, POLLIN, 0},
+                               {helper_sigpipe[0], POLLIN, 0}};
+        if (poll(fds, LENGTH(fds), -1) == -1) {
+            if (errno == EINTR)
+                continue;
+            _exit(EXIT_FAILURE);
+        }
+
+        if (fds[1].revents & POLLIN) {
+            while (read(helper_sigpipe[0], buf, sizeof(buf)) > 0)
+                ;
+            while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+                helper_report(fd, LAUNCH_EXITED, pid, status, 0);
         }
-        _exit(0);
+
+        if (fds[0].revents) {
+            if (recv(fd, &req, sizeof(req), 0) != sizeof(req))
+                _exit(EXIT_SUCCESS);
+            req.id[sizeof(req.id) - 1] = '\0';
+            req.cmd[sizeof(req.cmd) - 1] = '\0';
+            req.dir[sizeof(req.dir) - 1] = '\0';
+            req.env[sizeof(req.env) - 1] = '\0';
+
+            if ((pid = fork()) == 0)
+                helper_exec(&req);
+            helper_report(fd, pid == -1 ? LAUNCH_FAILED : LAUNCH_SPAWNED, pid,
+                          pid == -1 ? errno : 0, req.seq);
+        }
+    }
+}
+
+/* fork the helper while the heap is still small. on failure every launch
+ * falls back to posix_spawn. */
+static void helper_start(void) {
+    int sv[2];
+    pid_t pid;
+
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) == -1) {
+        warn("launch helper: socketpair: %s\n", strerror(errno));
+        return;
+    }
+
+    if ((pid = fork()) == -1) {
+        warn("launch helper: fork: %s\n", strerror(errno));
+        close(sv[0]);
+        close(sv[1]);
+        return;
+    }
+
+    if (pid == 0) {
+        /* close, not xcb_disconnect: that would shut the socket down for
+         * the window manager too */
+        close(xcb_get_file_descriptor(conn));
+        close(sv[0]);
+        helper_main(sv[1]);
+    }
+
+    close(sv[1]);
+    helper_fd = sv[0];
+    fcntl(helper_fd, F_SETFD, FD_CLOEXEC);
+    fcntl(helper_fd, F_SETFL, O_NONBLOCK);
+    PRINTF("launch helper: pid %d\n", pid);
+}
+
+static void helper_stop(void) {
+    warn("launch helper: gone, spawning directly\n");
+    close(helper_fd);
+    helper_fd = -1;
+}
+
+static bool copy_field(char *dst, size_t size, const char *src) {
+    if (!src) {
+        dst[0] = '\0';
+        return true;
     }
+    return (size_t)snprintf(dst, size, "%s", src) < size;
+}
+
+/* hand a launch to the helper: one send() and no waiting */
+static bool helper_launch(const Command *cmd, const char *id, uint32_t seq) {
+    struct launch_request req;
+
+    if (helper_fd == -1)
+        return false;
+
+    memset(&req, 0, sizeof(req));
+    req.seq = seq;
+    req.mem_limit = cmd->mem_limit;
+    if (!copy_field(req.id, sizeof(req.id), id) ||
+        !copy_field(req.cmd, sizeof(req.cmd), cmd->com) ||
+        !copy_field(req.dir, sizeof(req.dir), cmd->dir) ||
+        !copy_field(req.env, sizeof(req.env), cmd->env))
+        return false;
+
+    if (send(helper_fd, &req, sizeof(req), MSG_NOSIGNAL) == -1) {
+        if (errno != EAGAIN)
+            helper_stop();
+        return false;
+    }
+    return true;
+}
+
+void launch_setup(void) {
+    struct sigaction sa = {.sa_handler = sigchld,
+                           .sa_flags = SA_RESTART | SA_NOCLDSTOP};
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGCHLD, &sa, NULL) == -1)
+        warn("failed to add SIGCHLD handler.\n");
+
+    /* launched programs don't get to keep our X connection */
+    fcntl(xcb_get_file_descriptor(conn), F_SETFD, FD_CLOEXEC);
+
+    if (launch_helper)
+        helper_start();
+}
+
+/* remember which workspace a launch started from. returns its tag. */
+static uint32_t launch_record(const char *com, const char *id) {
+    const int i = launch_seq % LAUNCH_MAX;
+
+    if (++launch_seq == 0)
+        launch_seq = 1;
+    launches[i].seq = launch_seq;
+    launches[i].pid = 0;
+    launches[i].ws = selws;
+    snprintf(launches[i].id, sizeof(launches[i].id), "%s", id ? id : "");
+    launches[i].com = com;
+    launches[i].key_time = last_timestamp;
+    launches[i].launched = stats_now();
+    launches[i].mapped = launches[i].focused = 0;
+    launches[i].win = XCB_NONE;
+    return launch_seq;
+}
+
+static uint32_t usec(uint64_t from, uint64_t to) {
+    const uint64_t us = (to - from) / 1000;
+    return us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+}
+
+/* the sample table for com. commands are static, so the pointer is the
+ * key; the least used entry makes room once the table is full. */
+static int latency_slot(const char *com) {
+    int i, least = 0;
+
+    for (i = 0; i < LATENCY_MAX && latency[i].com; i++) {
+        if (latency[i].com == com)
+            return i;
+        if (latency[i].maps < latency[least].maps)
+            least = i;
+    }
+    if (i == LATENCY_MAX)
+        i = least;
+    memset(&latency[i], 0, sizeof(latency[i]));
+    latency[i].com = com;
+    return i;
+}
+
+static int launch_find_seq(uint32_t seq) {
+    for (int i = 0; i < LAUNCH_MAX; i++)
+        if (launches[i].seq && launches[i].seq == seq)
+            return i;
+    return -1;
+}
+
+static void launch_forget_id(const char *id) {
+    if (!id)
+        return;
+    for (int i = 0; i < LAUNCH_MAX; i++)
+        if (launches[i].seq && strcmp(launches[i].id, id) == 0)
+            launches[i].seq = 0;
+}
 
-    wait(0);
-    if (notify)
-        cursor_set_window_cursor(screen->root, XC_WATCH);
+/* without a startup id the pid is all there is to match on */
+static void launch_forget_pid(pid_t pid) {
+    for (int i = 0; i < LAUNCH_MAX; i++)
+        if (launches[i].seq && launches[i].pid == pid && !launches[i].id[0])
+            launches[i].seq = 0;
+}
+
+/* forget the launches spawned without the helper whose process exited */
+static void launch_reap(void) {
+    sigset_t set, old;
+
+    sigemptyset(&set);
+    sigaddset(&set, SIGCHLD);
+    pthread_sigmask(SIG_BLOCK, &set, &old);
+    for (int i = 0; i < nreaped; i++)
+        launch_forget_pid(reaped[i]);
+    nreaped = 0;
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+}
+
+/* ask for what launch_match() needs to know of win, if any launch is
+ * still waiting for a window. returns the last sequence number sent, 0
+ * if none. */
+unsigned int launch_query(xcb_window_t win, LaunchQuery *q) {
+    const uint64_t now = stats_now();
+    bool waiting = false;
+
+    q->sent = false;
+    launch_reap();
+    for (int i = 0; i < LAUNCH_MAX; i++) {
+        if (!launches[i].seq || launches[i].mapped)
+            continue;
+        if (now - launches[i].launched > LAUNCH_TIMEOUT)
+            launches[i].seq = 0;
+        else
+            waiting = true;
+    }
+    if (!waiting)
+        return 0;
+
+    q->id = backend_get_property(win, NET_STARTUP_ID, ewmh->UTF8_STRING,
+                                 sizeof(launches[0].id) / 4);
+    q->pid = backend_get_property(win, ewmh->_NET_WM_PID, XCB_ATOM_CARDINAL, 1);
+    q->sent = true;
+    return q->pid;
+}
+
+/* find the workspace win was launched from, by _NET_STARTUP_ID or else
+ * _NET_WM_PID, from the replies to launch_query(). a launch is matched
+ * to its first window only. */
+bool launch_match(xcb_window_t win, const LaunchQuery *q, unsigned int *ws) {
+    xcb_get_property_reply_t *r;
+    uint32_t pid;
+    int i, found = -1;
+
+    if (!q->sent)
+        return false;
+
+    /* both in one round trip */
+    stats_wait(q->pid);
+    if ((r = backend_reply(q->id))) {
+        const int len = xcb_get_property_value_length(r);
+        const char *id = xcb_get_property_value(r);
+        for (i = 0; len > 0 && i < LAUNCH_MAX; i++)
+            if (launches[i].seq && !launches[i].mapped &&
+                (size_t)len == strlen(launches[i].id) &&
+                memcmp(launches[i].id, id, len) == 0)
+                found = i;
+        FREE(r);
+    }
+
+    r = backend_reply(q->pid);
+    if (xcb_ewmh_get_wm_pid_from_reply(&pid, r) && found == -1)
+        for (i = 0; i < LAUNCH_MAX; i++)
+            if (launches[i].seq && !launches[i].mapped &&
+                launches[i].pid == (pid_t)pid)
+                found = i;
+    FREE(r);
+
+    if (found == -1)
+        return false;
+
+    PRINTF("launch_match: win %#x from launch %u on workspace %u\n", win,
+           launches[found].seq, launches[found].ws);
+    *ws = launches[found].ws;
+
+    const int l = latency_slot(launches[found].com);
+    launches[found].mapped = stats_now();
+    launches[found].win = win;
+    latency[l].map_us[latency[l].maps++ % LATENCY_SAMPLES] =
+        usec(launches[found].launched, launches[found].mapped);
+    return true;
+}
+
+/* called from focus(). closes the trace of a launch's first window. */
+void launch_focused(xcb_window_t win) {
+    for (int i = 0; i < LAUNCH_MAX; i++) {
+        if (!launches[i].seq || launches[i].win != win || launches[i].focused)
+            continue;
+        const int l = latency_slot(launches[i].com);
+        launches[i].focused = stats_now();
+        latency[l].focus_us[latency[l].focuses++ % LATENCY_SAMPLES] =
+            usec(launches[i].launched, launches[i].focused);
+        PRINTF("launch %u: pid %d map %u us focus %u us: %s\n",
+               launches[i].seq, launches[i].pid,
+               usec(launches[i].launched, launches[i].mapped),
+               usec(launches[i].launched, launches[i].focused),
+               launches[i].com);
+        /* the trace is complete */
+        launches[i].seq = 0;
+    }
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    const uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* p50, p95 and max of the last n samples */
+static void percentiles(const uint32_t *samples, uint32_t n, uint32_t out[3]) {
+    uint32_t sorted[LATENCY_SAMPLES];
+
+    if (n > LATENCY_SAMPLES)
+        n = LATENCY_SAMPLES;
+    if (n == 0) {
+        out[0] = out[1] = out[2] = 0;
+        return;
+    }
+    memcpy(sorted, samples, n * sizeof(uint32_t));
+    qsort(sorted, n, sizeof(uint32_t), cmp_u32);
+    out[0] = sorted[(n - 1) / 2];
+    out[1] = sorted[(n - 1) * 95 / 100];
+    out[2] = sorted[n - 1];
+}
+
+/* launch-to-map and launch-to-focus latency per command, plus the
+ * launches still being traced */
+void launch_dump(FILE *out, FILE *tsv) {
+    const uint64_t now = stats_now();
+    uint32_t m[3], f[3];
+
+    fprintf(out, "launch latency (us)     maps  p50  p95  max  focuses  "
+                 "p50  p95  max\n");
+    if (tsv)
+        fprintf(tsv, "command\tmaps\tmap_p50_us\tmap_p95_us\tmap_max_us\t"
+                     "focuses\tfocus_p50_us\tfocus_p95_us\tfocus_max_us\n");
+
+    for (int i = 0; i < LATENCY_MAX && latency[i].com; i++) {
+        percentiles(latency[i].map_us, latency[i].maps, m);
+        percentiles(latency[i].focus_us, latency[i].focuses, f);
+        fprintf(out, "  %s\n  %26u %4u %4u %4u %8u %4u %4u %4u\n",
+                latency[i].com, latency[i].maps, m[0], m[1], m[2],
+                latency[i].focuses, f[0], f[1], f[2]);
+        if (tsv)
+            fprintf(tsv, "%s\t%u\t%u\t%u\t%u\t%u\t%u\t%u\t%u\n",
+                    latency[i].com, latency[i].maps, m[0], m[1], m[2],
+                    latency[i].focuses, f[0], f[1], f[2]);
+    }
+
+    for (int i = 0; i < LAUNCH_MAX; i++) {
+        if (!launches[i].seq)
+            continue;
+        fprintf(out,
+                "  launch %u: pid %d key %u age %u us map %u us "
+                "focus %u us id %s: %s\n",
+                launches[i].seq, launches[i].pid, launches[i].key_time,
+                usec(launches[i].launched, now),
+                launches[i].mapped
+                    ? usec(launches[i].launched, launches[i].mapped)
+                    : 0,
+                launches[i].focused
+                    ? usec(launches[i].launched, launches[i].focused)
+                    : 0,
+                launches[i].id[0] ? launches[i].id : "-", launches[i].com);
+    }
+}
+
+int launch_fd(void) {
+    return helper_fd;
+}
+
+void launch_read_reports(void) {
+    struct launch_report rep;
+    ssize_t n;
+    int i;
+
+    while ((n = recv(helper_fd, &rep, sizeof(rep), 0)) == sizeof(rep)) {
+        switch (rep.type) {
+        case LAUNCH_SPAWNED:
+            PRINTF("launch helper: pid %d for launch %u\n", rep.pid, rep.seq);
+            if ((i = launch_find_seq(rep.seq)) != -1)
+                launches[i].pid = rep.pid;
+            break;
+        case LAUNCH_FAILED:
+            warn("launch helper: fork failed: %s\n", strerror(rep.status));
+            if ((i = launch_find_seq(rep.seq)) != -1)
+                launches[i].seq = 0;
+            break;
+        case LAUNCH_EXITED:
+            PRINTF("launch helper: pid %d exited with %d\n", rep.pid,
+                   rep.status);
+            launch_forget_pid(rep.pid);
+            break;
+        }
+    }
+
+    if (n == 0 || (n == -1 && errno != EAGAIN && errno != EINTR))
+        helper_stop();
+}
+
+/* the current environment with DESKTOP_STARTUP_ID set to id */
+static char **startup_environ(const char *id) {
+    size_t n = 0;
+    while (environ[n])
+        n++;
+
+    char **env;
+    if (!(env = malloc((n + 2) * sizeof(char *))))
+        err("can't allocate memory.");
+
+    size_t j = 0;
+    for (size_t i = 0; i < n; i++)
+        if (strncmp(environ[i], STARTUP_ID_ENV, strlen(STARTUP_ID_ENV)) != 0)
+            env[j++] = environ[i];
+
+    const size_t len = strlen(STARTUP_ID_ENV) + strlen(id) + 1;
+    if (!(env[j] = malloc(len)))
+        err("can't allocate memory.");
+    snprintf(env[j++], len, "%s%s", STARTUP_ID_ENV, id);
+    env[j] = NULL;
+    return env;
+}
+
+/* fallback when there's no helper. the working directory, extra variable
+ * and memory limit need code in the child, so they only apply with it. */
+static bool spawn_direct(const char *cmd, const char *id, uint32_t seq) {
+    char **env = id ? startup_environ(id) : environ;
+
+    /* posix_spawn avoids copying our address space just to exec */
+    posix_spawnattr_t attr;
+    sigset_t mask, defaults;
+    short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+
+    posix_spawnattr_init(&attr);
+#ifdef POSIX_SPAWN_SETSID
+    flags |= POSIX_SPAWN_SETSID;
+#else
+    flags |= POSIX_SPAWN_SETPGROUP;
+    posix_spawnattr_setpgroup(&attr, 0);
+#endif
+    sigemptyset(&mask);
+    posix_spawnattr_setsigmask(&attr, &mask);
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGCHLD);
+    sigaddset(&defaults, SIGINT);
+    sigaddset(&defaults, SIGTERM);
+    sigaddset(&defaults, SIGHUP);
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+    posix_spawnattr_setflags(&attr, flags);
+
+    pid_t pid;
+    char *const argv[] = {"/bin/sh", "-c", (char *)cmd, NULL};
+    int ret = posix_spawn(&pid, "/bin/sh", NULL, &attr, argv, env);
+    posix_spawnattr_destroy(&attr);
+
+    if (id) {
+        /* only the last entry was allocated for us */
+        char **e = env;
+        while (e[1])
+            e++;
+        FREE(*e);
+        FREE(env);
+    }
+
+    if (ret != 0) {
+        warn("launch_application: can't spawn '%s': %s\n", cmd, strerror(ret));
+        return false;
+    }
+    PRINTF("launch_application: pid %d: %s\n", pid, cmd);
+    const int i = launch_find_seq(seq);
+    if (i != -1)
+        launches[i].pid = pid;
+    return true;
+}
+
+void launch_application(const Command *cmd) {
+    SnLauncherContext *context = NULL;
+    const char *id = NULL;
+    uint32_t seq;
+    bool ok;
+
+    if (cmd->notify) {
+        context = sn_launcher_context_new(sndisplay, scrno);
+        sn_launcher_context_set_name(context, __WM_NAME__);
+        sn_launcher_context_set_description(context, "launch application");
+        sn_launcher_context_set_workspace(context, selws);
+        sn_launcher_context_initiate(context, __WM_NAME__, cmd->com,
+                                     last_timestamp);
+        id = sn_launcher_context_get_startup_id(context);
+        PRINTF("launch_application: startup id: %s\n", id);
+    }
+
+    seq = launch_record(cmd->com, id);
+    ok = helper_launch(cmd, id, seq) || spawn_direct(cmd->com, id, seq);
+    const int i = launch_find_seq(seq);
+    if (!ok && i != -1)
+        launches[i].seq = 0;
+
+    if (cmd->notify) {
+        if (ok)
+            cursor_set_window_cursor(screen->root, XC_WATCH);
+        else
+            sn_launcher_context_complete(context);
+        sn_launcher_context_unref(context);
+    }
 }
 
 void startup_event_cb(SnMonitorEvent *event, void *user_data) {
@@ -50,17 +659,21 @@ void startup_event_cb(SnMonitorEvent *event, void *user_data) {
             PRINTF("Changed sequence %s\n",
                    sn_startup_sequence_get_id(sequence));
         }
+#ifdef DEBUG
         const char *s = sn_startup_sequence_get_id(sequence);
         PRINTF(" id %s\n", s ? s : "(unset)");
+#endif
         PRINTF(" workspace %d\n", sn_startup_sequence_get_workspace(sequence));
         break;
     }
     case SN_MONITOR_EVENT_COMPLETED:
         PRINTF("Completed sequence %s\n", sn_startup_sequence_get_id(sequence));
         cursor_set_window_cursor(screen->root, XC_POINTER);
+        launch_forget_id(sn_startup_sequence_get_id(sequence));
         break;
     case SN_MONITOR_EVENT_CANCELED:
         PRINTF("Canceled sequence %s\n", sn_startup_sequence_get_id(sequence));
+        launch_forget_id(sn_startup_sequence_get_id(sequence));
         break;
     }
 }
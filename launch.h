@@ -2,9 +2,23 @@
 #ifndef LAUNCH_H
 #define LAUNCH_H
 
+#include <stdio.h>
 #include <libsn/sn-monitor.h>
 
-void launch_application(const char *cmd, const bool notify);
+void launch_setup(void);
+int launch_fd(void);
+void launch_read_reports(void);
+/* the requests launch_match() reads the replies to */
+typedef struct {
+    unsigned int id, pid;
+    bool sent;
+} LaunchQuery;
+
+unsigned int launch_query(xcb_window_t win, LaunchQuery *q);
+bool launch_match(xcb_window_t win, const LaunchQuery *q, unsigned int *ws);
+void launch_focused(xcb_window_t win);
+void launch_dump(FILE *out, FILE *tsv);
+void launch_application(const Command *cmd);
 void startup_event_cb(SnMonitorEvent *event, void *user_data);
 
 #endif
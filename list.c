@@ -1,19 +1,132 @@
 /* See LICENSE file for copyright and license details. */
+#include <string.h>
 #include "main.h"
 #include "list.h"
 #include "client.h"
 #include "xcb.h"
 #include "workspace.h"
+#include "stats.h"
 #include "log.h"
 
+/* clients by window, chained through hnext. it grows to keep about one
+ * client per bucket, since nearly every event looks its window up.
+ * frames has the same size and holds framed clients by frame, chained
+ * through fnext, for clicks and anything else reported on a frame. */
+static Client **table, **frames;
+static uint32_t table_size, table_count;
+
+static uint32_t hash(xcb_window_t w) {
+    return (w * 2654435761u) & (table_size - 1);
+}
+
+static void table_grow(void) {
+    Client **old = table;
+    const uint32_t old_size = table_size;
+
+    table_size = table_size ? table_size * 2 : 64;
+    FREE(frames);
+    if (!(table = calloc(table_size, sizeof(Client *))) ||
+        !(frames = calloc(table_size, sizeof(Client *))))
+        err("can't allocate memory.");
+
+    /* every client is on the old window chains, framed or not */
+    for (uint32_t i = 0; i < old_size; i++) {
+        Client *c, *n;
+        for (c = old[i]; c; c = n) {
+            n = c->hnext;
+            c->hnext = table[hash(c->win)];
+            table[hash(c->win)] = c;
+            if (c->frame) {
+                c->fnext = frames[hash(c->frame)];
+                frames[hash(c->frame)] = c;
+            }
+        }
+    }
+    FREE(old);
+}
+
+/* clients are carved out of slabs, so the ones a walk of clients or
+ * stack visits sit next to each other rather than wherever malloc put
+ * them. each starts a cache line, so the hot fields at its front are one
+ * line. a client keeps its address until freed; freed ones are reused
+ * first. the slabs go when the last client does. */
+#define CLIENT_SLAB 64
+#define CACHE_LINE 64
+#define CLIENT_STRIDE                                                          \
+    ((sizeof(Client) + CACHE_LINE - 1) & ~(size_t)(CACHE_LINE - 1))
+/* the header takes the first line, the clients follow */
+#define SLAB_SIZE (CACHE_LINE + CLIENT_SLAB * CLIENT_STRIDE)
+
+struct slab {
+    struct slab *next;
+};
+
+static struct slab *slabs;
+static Client *free_clients; /* chained through next */
+static uint32_t slab_count, clients_live;
+
+Client *client_alloc(void) {
+    Client *c;
+
+    if (!free_clients) {
+        struct slab *s;
+        if (posix_memalign((void **)&s, CACHE_LINE, SLAB_SIZE))
+            err("can't allocate memory.");
+        s->next = slabs;
+        slabs = s;
+        slab_count++;
+        /* hand them out in address order */
+        for (int i = CLIENT_SLAB - 1; i >= 0; i--) {
+            c = (Client *)((char *)s + CACHE_LINE + i * CLIENT_STRIDE);
+            c->next = free_clients;
+            free_clients = c;
+        }
+    }
+    c = free_clients;
+    free_clients = c->next;
+    clients_live++;
+    memset(c, 0, sizeof(*c));
+    return c;
+}
+
+void client_free(Client *c) {
+    struct slab *s;
+
+    c->next = free_clients;
+    free_clients = c;
+    if (--clients_live > 0)
+        return;
+    while ((s = slabs)) {
+        slabs = s->next;
+        FREE(s);
+    }
+    free_clients = NULL;
+    slab_count = 0;
+}
+
 void attach(Client *c) {
     c->next = clients;
     clients = c;
+
+    if (table_count >= table_size)
+        table_grow();
+    c->hnext = table[hash(c->win)];
+    table[hash(c->win)] = c;
+    if (c->frame) {
+        c->fnext = frames[hash(c->frame)];
+        frames[hash(c->frame)] = c;
+    }
+    table_count++;
 }
 
+/* the stack by count, for a query that meets clients in another order:
+ * the higher count is higher in the stack */
+static uint32_t stack_count;
+
 void attachstack(Client *c) {
     c->snext = stack;
     stack = c;
+    c->stacked = ++stack_count;
 }
 
 void detach(Client *c) {
@@ -22,6 +135,60 @@ void detach(Client *c) {
     for (tc = &clients; *tc && *tc != c; tc = &(*tc)->next)
         continue;
     *tc = c->next;
+
+    for (tc = &table[hash(c->win)]; *tc && *tc != c; tc = &(*tc)->hnext)
+        continue;
+    *tc = c->hnext;
+    if (c->frame) {
+        for (tc = &frames[hash(c->frame)]; *tc && *tc != c;
+             tc = &(*tc)->fnext)
+            continue;
+        *tc = c->fnext;
+    }
+    if (--table_count == 0) {
+        FREE(table);
+        FREE(frames);
+        table_size = 0;
+    }
+}
+
+Client *wintoclient(xcb_window_t w) {
+    Client *c;
+
+    if (!table)
+        return NULL;
+    for (c = table[hash(w)]; c; c = c->hnext)
+        if (c->win == w)
+            return c;
+    return NULL;
+}
+
+Client *frame_to_client(xcb_window_t f) {
+    Client *c;
+
+    if (!frames || f == XCB_NONE)
+        return NULL;
+    for (c = frames[hash(f)]; c; c = c->fnext)
+        if (c->frame == f)
+            return c;
+    return NULL;
+}
+
+/* what the clients take up on the heap, for the stats dump */
+size_t clients_size(uint32_t *count) {
+    size_t size = 2 * table_size * sizeof(Client *) +
+                  slab_count * SLAB_SIZE;
+
+    *count = 0;
+    for (Client *c = clients; c; c = c->next) {
+        (*count)++;
+        if (c->role)
+            size += strlen(c->role) + 1;
+        if (c->class._reply)
+            size += sizeof(xcb_get_property_reply_t) +
+                    xcb_get_property_value_length(c->class._reply);
+    }
+    return size;
 }
 
 void detachstack(Client *c) {
@@ -40,27 +207,31 @@ void detachstack(Client *c) {
 
 void focusstack(bool next) {
     Client *c = NULL, *i;
+    StatsMark mark;
 
     if (!sel)
         return;
+    stats_start(&mark, STAT_CYCLE);
     if (next) {
-        for (c = sel->next; c && !ISVISIBLE(c); c = c->next)
+        for (c = sel->next; c && (!ISVISIBLE(c) || ISUNFRAMED(c));
+             c = c->next)
             ;
         if (!c)
-            for (c = clients; c && !ISVISIBLE(c); c = c->next)
+            for (c = clients; c && (!ISVISIBLE(c) || ISUNFRAMED(c));
+                 c = c->next)
                 ;
     } else {
         for (i = clients; i != sel; i = i->next)
-            if (ISVISIBLE(i))
+            if (ISVISIBLE(i) && !ISUNFRAMED(i))
                 c = i;
         if (!c)
             for (; i; i = i->next)
-                if (ISVISIBLE(i))
+                if (ISVISIBLE(i) && !ISUNFRAMED(i))
                     c = i;
     }
     if (c) {
         focus(c);
-        raisewindow(sel->frame);
-        raisewindow(sel->win);
+        raiseclient(sel);
     }
+    stats_record(&mark);
 }
@@ -2,10 +2,15 @@
 #ifndef LIST_H
 #define LIST_H
 
+Client *client_alloc(void);
+void client_free(Client *c);
 void attach(Client *c);
 void attachstack(Client *c);
 void detach(Client *c);
 void detachstack(Client *c);
 void focusstack(bool next);
+Client *wintoclient(xcb_window_t w);
+Client *frame_to_client(xcb_window_t f);
+size_t clients_size(uint32_t *count);
 
 #endif
@@ -1,5 +1,8 @@
 /* See LICENSE file for copyright and license details. */
 #include <sys/queue.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
@@ -10,6 +13,7 @@
 #include <xcb/xcb_ewmh.h>
 #include <libsn/sn-monitor.h>
 #include "main.h"
+#include "backend.h"
 #include "log.h"
 #include "list.h"
 #include "client.h"
@@ -19,8 +23,14 @@
 #include "cursor.h"
 #include "ewmh.h"
 #include "config.h"
+#include "geom.h"
 #include "xcb.h"
 #include "launch.h"
+#include "memo.h"
+#include "prop.h"
+#include "stats.h"
+#include "trace.h"
+#include "watchdog.h"
 
 xcb_connection_t *conn;
 xcb_screen_t *screen;
@@ -32,39 +42,53 @@ uint32_t unfocus_pixel;
 xcb_atom_t WM_DELETE_WINDOW;
 xcb_atom_t WM_TAKE_FOCUS;
 xcb_atom_t WM_PROTOCOLS;
+xcb_atom_t NET_STARTUP_ID;
+xcb_atom_t WM_WINDOW_ROLE;
 xcb_timestamp_t last_timestamp;
 Client *sel;
 Client *clients;
 Client *stack;
 
 static volatile sig_atomic_t sigcode;
+static volatile sig_atomic_t dumpstats;
 static volatile bool restart_wm;
+/* sigcatch() writes a byte here, so a signal that lands after run() has
+ * checked the flags above still wakes its poll() */
+static int wakeup[2] = {-1, -1};
 
 static void cleanup(void) {
     Client *c;
     for (c = clients; c; c = c->next) {
-        xcb_reparent_window(conn, c->win, screen->root, c->geom.x, c->geom.y);
+        if (!ISUNFRAMED(c))
+            backend_reparent(c->win, screen->root, c->geom.x, c->geom.y);
     }
     xcb_aux_sync(conn);
 
-    // FIXME
-    while (stack) {
-        PRINTF("unmap and free win %#x\n", stack->win);
-        xcb_unmap_window(conn, stack->win);
-        detach(stack);
-        detachstack(stack);
-        FREE(stack);
-        ewmh_update_client_list(clients);
-        focus(NULL);
+    /* clients is newest first, so each detach() is constant time */
+    while ((c = clients)) {
+        if (!ISUNFRAMED(c)) {
+            PRINTF("unmap and free win %#x\n", c->win);
+            backend_unmap(c->win);
+            geom_remove(c);
+        }
+        detach(c);
+        prop_wipe(c);
+        client_free(c);
     }
+    stack = NULL;
+    ewmh_update_client_list(clients);
+    focus(NULL);
+    prop_teardown();
+    memo_teardown();
     ewmh_teardown();
+    freekeysyms();
     cursor_free_context();
     FREE(focus_color);
     FREE(unfocus_color);
-    xcb_set_input_focus(conn, XCB_NONE, XCB_INPUT_FOCUS_POINTER_ROOT,
-                        XCB_CURRENT_TIME);
+    backend_focus(XCB_NONE);
     xcb_flush(conn);
     xcb_disconnect(conn);
+    trace_teardown();
     PRINTF("bye\n");
 }
 
@@ -85,6 +109,7 @@ static void remanage_windows(void) {
             continue;
 
         PRINTF("remanage_windows: %#x\n", children[i]);
+        trace_capture(CAPTURE_MANAGE, children[i], NULL, 0);
         manage(children[i]);
 
         xcb_get_window_attributes_cookie_t wac =
@@ -105,12 +130,46 @@ static void remanage_windows(void) {
 
 static void run(void) {
     xcb_generic_event_t *ev;
+    struct pollfd fds[3];
+    char buf[16];
+
+    fds[0].fd = xcb_get_file_descriptor(conn);
+    fds[2].fd = wakeup[0];
+    fds[0].events = fds[1].events = fds[2].events = POLLIN;
 
     while (sigcode == 0) {
+        if (dumpstats) {
+            dumpstats = 0;
+            stats_dump();
+        }
         xcb_flush(conn);
-        if ((ev = xcb_wait_for_event(conn)) != NULL) {
-            handleevent(ev);
-            FREE(ev);
+        /* wait on X, on reports from the launch helper and on signals */
+        if ((ev = xcb_poll_for_event(conn)) == NULL) {
+            fds[1].fd = launch_fd();
+            fds[0].revents = fds[1].revents = fds[2].revents = 0;
+            watchdog_idle();
+            if (poll(fds, LENGTH(fds), -1) == -1 && errno != EINTR)
+                warn("poll: %s\n", strerror(errno));
+            watchdog_busy();
+            if (fds[1].revents)
+                launch_read_reports();
+            if (fds[2].revents)
+                while (read(wakeup[0], buf, sizeof(buf)) > 0)
+                    ;
+            ev = xcb_poll_for_event(conn);
+        }
+        if (ev != NULL) {
+            unsigned int depth = 0;
+            /* drain the queue before flushing again */
+            do {
+                trace_capture(CAPTURE_EVENT, XCB_NONE, ev, CAPTURE_EVENT_SIZE);
+                handleevent(ev);
+                FREE(ev);
+                depth++;
+            } while ((ev = xcb_poll_for_queued_event(conn)) != NULL);
+            trace_capture(CAPTURE_DRAINED, XCB_NONE, NULL, 0);
+            handlepending();
+            stats_drain(depth);
         }
         if (connection_has_error()) {
             cleanup();
@@ -124,8 +183,13 @@ static void setup(void) {
     if (!screen)
         err("can't find screen.");
 
+    /* first, so a launch helper forks from a small process */
+    launch_setup();
+    watchdog_setup();
+
     /* subscribe to handler */
-    const uint32_t vals[] = {XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY |
+    const uint32_t vals[] = {XCB_EVENT_MASK_STRUCTURE_NOTIFY |
+                             XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY |
                              XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT |
                              XCB_EVENT_MASK_BUTTON_PRESS |
                              XCB_EVENT_MASK_PROPERTY_CHANGE};
@@ -141,6 +205,8 @@ static void setup(void) {
     getatom(&WM_DELETE_WINDOW, "WM_DELETE_WINDOW");
     getatom(&WM_TAKE_FOCUS, "WM_TAKE_FOCUS");
     getatom(&WM_PROTOCOLS, "WM_PROTOCOLS");
+    getatom(&NET_STARTUP_ID, "_NET_STARTUP_ID");
+    getatom(&WM_WINDOW_ROLE, "WM_WINDOW_ROLE");
 
     updatenumlockmask();
     grabkeys();
@@ -159,16 +225,20 @@ static void setup(void) {
     cursor_set_window_cursor(screen->root, XC_POINTER);
 
     ewmh_setup();
+    prop_setup();
+    trace_session();
     remanage_windows();
 
     sndisplay = sn_xcb_display_new(conn, NULL, NULL);
     sn_monitor_context_new(sndisplay, scrno, startup_event_cb, NULL, NULL);
 
+    trace_capture(CAPTURE_READY, XCB_NONE, NULL, 0);
     focus(NULL);
 }
 
 static void sigcatch(int sig) {
-    PRINTF("caught signal %d\n", sig);
+    const int saved_errno = errno;
+
     switch (sig) {
     case SIGINT:
     case SIGTERM:
@@ -178,7 +248,14 @@ static void sigcatch(int sig) {
         restart_wm = true;
         sigcode = sig;
         break;
+    case SIGUSR1:
+        dumpstats = 1;
+        break;
+    }
+    if (write(wakeup[1], "", 1) == -1) {
+        /* full: a wakeup is already pending */
     }
+    errno = saved_errno;
 }
 
 void quit(const Arg *arg) {
@@ -201,6 +278,13 @@ int main(int argc, char **argv) {
     if (connection_has_error())
         return EXIT_FAILURE;
 
+    if (pipe(wakeup) == -1)
+        err("can't create a pipe.");
+    for (int i = 0; i < 2; i++) {
+        fcntl(wakeup[i], F_SETFL, O_NONBLOCK);
+        fcntl(wakeup[i], F_SETFD, FD_CLOEXEC);
+    }
+
     /* while handling a signal, reset disposition to SIG_DFL */
     struct sigaction sa = {.sa_handler = sigcatch, .sa_flags = SA_RESETHAND};
     sigemptyset(&sa.sa_mask);
@@ -211,6 +295,12 @@ int main(int argc, char **argv) {
         warn("failed to add signal handlers.\n");
     }
 
+    /* SIGUSR1 only asks for a stats dump, so it stays installed */
+    sa.sa_flags = 0;
+    if (sigaction(SIGUSR1, &sa, NULL) == -1)
+        warn("failed to add SIGUSR1 handler.\n");
+    trace_setup();
+
     /* load config */
     /* char *rc_path = NULL; */
     /* if ((rc_path = find_config("tfwmrc"))) { */
@@ -20,7 +20,7 @@
 #define LENGTH(X)       (int)(sizeof(X) / sizeof(X)[0])
 #define ISVISIBLE(C)    ((C)->ws == selws)
 
-#define KEY_MAX 65
+#define KEY_MAX 73
 #define RULE_MAX 2
 #define BUTTON_MAX 2
 
@@ -55,8 +55,16 @@ enum action {
     NextWindow
 };
 
+typedef struct {
+    const char *com;
+    bool notify;              /* use startup notification */
+    const char *dir;          /* working directory, or NULL */
+    const char *env;          /* extra NAME=value, or NULL */
+    unsigned long mem_limit;  /* RLIMIT_AS in bytes, 0 for none */
+} Command;
+
 typedef union {
-    char *com;
+    const Command *cmd;
     enum action i;
 } Arg;
 
@@ -84,22 +92,59 @@ enum {
     EWMH_ABOVE = (1 << 5)
 };
 
+/* how a window is managed, from _NET_WM_WINDOW_TYPE */
+enum {
+    WINTYPE_NORMAL,
+    WINTYPE_DIALOG, /* framed, but always centered */
+    WINTYPE_DESKTOP,
+    WINTYPE_DOCK,
+    WINTYPE_NOTIFICATION,
+    WINTYPE_POPUP
+};
+
+/* WM_NORMAL_HINTS, resolved once per update. zero means no limit. */
+typedef struct {
+    int32_t base_width, base_height;
+    int32_t min_width, min_height;
+    int32_t max_width, max_height;
+    int32_t width_inc, height_inc;
+    int32_t min_aspect_num, min_aspect_den;
+    int32_t max_aspect_num, max_aspect_den;
+    uint32_t win_gravity;
+} SizeHints;
+
+/* what list walks, lookups and showhide() read comes first, in the 62
+ * bytes up to ignore_unmap; list.c starts every client on a cache line,
+ * so that is one line per client. the properties behind it are only read
+ * for one client at a time. */
 typedef struct Client Client;
 struct Client {
-    xcb_rectangle_t geom;
-    xcb_rectangle_t old_geom;
-    xcb_size_hints_t size_hints;
-    int32_t wm_hints;
-    uint32_t ewmh_flags;
-    bool noborder;
-    bool can_focus;
-    bool can_delete;
-    xcb_window_t frame;
     Client *next;
     Client *snext;
+    Client *hnext; /* in the window lookup table */
+    Client *fnext; /* and in the frame one */
     xcb_window_t win;
+    xcb_window_t frame;
     unsigned int ws;
+    uint32_t ewmh_flags;
+    xcb_rectangle_t geom;
+    uint8_t type;
+    bool noborder;
+    bool can_focus;
+    bool can_delete;
+    uint8_t valid_props;
     uint8_t ignore_unmap;
+    uint32_t slot;    /* in geom.c's store, while framed */
+    uint32_t stacked; /* when last put on top of the stack */
+
+    xcb_rectangle_t old_geom;
+    SizeHints size_hints;
+    int32_t wm_hints;
+    xcb_icccm_get_wm_class_reply_t class;
+    char *role;
+    /* property requests sent and not yet read, one per PROP_ bit */
+    uint8_t fetching_props;
+    unsigned int prop_seq[5];
 };
 
 void quit(const Arg *arg);
@@ -113,6 +158,8 @@ extern xcb_ewmh_connection_t *ewmh;
 extern xcb_atom_t WM_DELETE_WINDOW;
 extern xcb_atom_t WM_TAKE_FOCUS;
 extern xcb_atom_t WM_PROTOCOLS;
+extern xcb_atom_t NET_STARTUP_ID;
+extern xcb_atom_t WM_WINDOW_ROLE;
 extern xcb_timestamp_t last_timestamp;
 extern Client *clients;
 extern Client *sel;
@@ -0,0 +1,231 @@
+/* See LICENSE file for copyright and license details. */
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "main.h"
+#include "memo.h"
+#include "client.h"
+#include "config.h"
+#include "ewmh.h"
+#include "prop.h"
+#include "workspace.h"
+#include "log.h"
+
+/* where windows of each class and role were last left, so they open
+ * there. the file is mapped, so saving is a store to memory and the
+ * kernel writes it back whenever it likes; it is only opened once the
+ * first window needs it. */
+#define MEMO_MAGIC "TFWMGEO1"
+#define MEMO_SLOTS 256
+#define MEMO_KEY 56
+#define MEMO_FLAGS (EWMH_MAXIMIZED_VERT | EWMH_MAXIMIZED_HORZ)
+
+/* the layout is the file format */
+struct memo_record {
+    uint32_t hash; /* of key, never 0; 0 marks a free slot */
+    uint32_t used; /* the clock when last saved, for eviction */
+    char key[MEMO_KEY]; /* class, NUL, role */
+    int16_t x, y;
+    uint16_t width, height;
+    uint32_t ws;
+    uint32_t ewmh_flags;
+};
+
+struct memo_file {
+    char magic[8];
+    uint32_t slots;
+    uint32_t clock;
+    struct memo_record records[MEMO_SLOTS];
+};
+
+static struct memo_file *memo;
+static bool memo_failed;
+
+static bool memo_open(void) {
+    const char *cache = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    char path[256];
+    struct stat st;
+    void *p;
+    int fd;
+
+    if (memo)
+        return true;
+    if (memo_failed)
+        return false;
+    memo_failed = true;
+
+    if (cache && *cache)
+        snprintf(path, sizeof(path), "%s/" __WM_NAME__ "-geometry", cache);
+    else if (home && *home)
+        snprintf(path, sizeof(path), "%s/.cache/" __WM_NAME__ "-geometry",
+                 home);
+    else
+        return false;
+
+    if ((fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600)) == -1) {
+        warn("memo: can't open %s\n", path);
+        return false;
+    }
+    if (fstat(fd, &st) == -1 ||
+        (st.st_size != sizeof(struct memo_file) &&
+         ftruncate(fd, sizeof(struct memo_file)) == -1)) {
+        warn("memo: can't size %s\n", path);
+        close(fd);
+        return false;
+    }
+    p = mmap(NULL, sizeof(struct memo_file), PROT_READ | PROT_WRITE,
+             MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        warn("memo: can't map %s\n", path);
+        return false;
+    }
+
+    memo = p;
+    /* new, or from some other version: start over */
+    if (memcmp(memo->magic, MEMO_MAGIC, sizeof(memo->magic)) != 0 ||
+        memo->slots != MEMO_SLOTS) {
+        memset(memo, 0, sizeof(*memo));
+        memcpy(memo->magic, MEMO_MAGIC, sizeof(memo->magic));
+        memo->slots = MEMO_SLOTS;
+    }
+    memo_failed = false;
+    return true;
+}
+
+/* class and role as last fetched, truncated to fit. false if there is
+ * no class. */
+static bool make_key(const Client *c, char *key, uint32_t *hash) {
+    size_t len;
+
+    if (!c->class.class_name)
+        return false;
+
+    memset(key, 0, MEMO_KEY);
+    len = strlen(c->class.class_name);
+    if (len > MEMO_KEY / 2 - 1)
+        len = MEMO_KEY / 2 - 1;
+    memcpy(key, c->class.class_name, len);
+    if (c->role)
+        strncpy(key + len + 1, c->role, MEMO_KEY - len - 2);
+
+    /* FNV-1a */
+    *hash = 2166136261u;
+    for (int i = 0; i < MEMO_KEY; i++)
+        *hash = (*hash ^ (uint8_t)key[i]) * 16777619u;
+    if (*hash == 0)
+        *hash = 1;
+    return true;
+}
+
+/* the slot holding key, or the free one it would go in, or NULL. slots
+ * are only ever reused, never freed, so a probe can stop at a free one. */
+static struct memo_record *find(const char *key, uint32_t hash) {
+    for (uint32_t i = 0; i < MEMO_SLOTS; i++) {
+        struct memo_record *r = &memo->records[(hash + i) % MEMO_SLOTS];
+        if (r->hash == 0 ||
+            (r->hash == hash && memcmp(r->key, key, MEMO_KEY) == 0))
+            return r;
+    }
+    return NULL;
+}
+
+/* before the first map: put c where its kind was last left. true if it
+ * was, and so needs no placing. */
+bool memo_apply(Client *c) {
+    char key[MEMO_KEY];
+    uint32_t hash;
+    struct memo_record *r;
+    int32_t w, h;
+
+    if (!remember_geometry)
+        return false;
+    prop_fetch(c, PROP_CLASS | PROP_ROLE);
+    if (!make_key(c, key, &hash) || !memo_open())
+        return false;
+    if (!(r = find(key, hash)) || r->hash == 0)
+        return false;
+
+    w = r->width;
+    h = r->height;
+    applysizehints(c, &w, &h);
+    c->geom.x = r->x;
+    c->geom.y = r->y;
+    c->geom.width = w;
+    c->geom.height = h;
+    c->old_geom = c->geom;
+    if (r->ws < WORKSPACES)
+        c->ws = r->ws;
+    if (r->ewmh_flags & MEMO_FLAGS) {
+        /* maximized again, with the record to go back to */
+        c->ewmh_flags |= r->ewmh_flags & MEMO_FLAGS;
+        if (ISMAXVERT(c)) {
+            c->geom.y = 0;
+            h = screen->height_in_pixels - (c->noborder ? 0 : border_width * 2);
+        }
+        if (ISMAXHORZ(c)) {
+            c->geom.x = 0;
+            w = screen->width_in_pixels - (c->noborder ? 0 : border_width * 2);
+        }
+        applysizehints(c, &w, &h);
+        c->geom.width = w;
+        c->geom.height = h;
+        ewmh_update_wm_state(c);
+    }
+    PRINTF("memo: win %#x to (%d,%d) %dx%d on %u\n", c->win, c->geom.x,
+           c->geom.y, c->geom.width, c->geom.height, c->ws);
+    return true;
+}
+
+/* on unmanage and drag release. the window may be gone already, so
+ * this only uses what is cached. */
+void memo_save(Client *c) {
+    char key[MEMO_KEY];
+    uint32_t hash;
+    struct memo_record *r;
+    /* a maximized axis is saved as what it goes back to */
+    xcb_rectangle_t g = c->geom;
+
+    if (ISMAXVERT(c)) {
+        g.y = c->old_geom.y;
+        g.height = c->old_geom.height;
+    }
+    if (ISMAXHORZ(c)) {
+        g.x = c->old_geom.x;
+        g.width = c->old_geom.width;
+    }
+
+    if (!remember_geometry || ISUNFRAMED(c) || ISFULLSCREEN(c) ||
+        !make_key(c, key, &hash) || !memo_open())
+        return;
+
+    /* full: evict whatever went longest unsaved */
+    if (!(r = find(key, hash))) {
+        r = &memo->records[0];
+        for (int i = 1; i < MEMO_SLOTS; i++)
+            if (memo->records[i].used < r->used)
+                r = &memo->records[i];
+    }
+
+    r->hash = hash;
+    r->used = ++memo->clock;
+    memcpy(r->key, key, MEMO_KEY);
+    r->x = g.x;
+    r->y = g.y;
+    r->width = g.width;
+    r->height = g.height;
+    r->ws = c->ws;
+    r->ewmh_flags = c->ewmh_flags & MEMO_FLAGS;
+}
+
+void memo_teardown(void) {
+    if (!memo)
+        return;
+    msync(memo, sizeof(*memo), MS_ASYNC);
+    munmap(memo, sizeof(*memo));
+    memo = NULL;
+}
@@ -0,0 +1,9 @@
+/* See LICENSE file for copyright and license details. */
+#ifndef MEMO_H
+#define MEMO_H
+
+bool memo_apply(Client *c);
+void memo_save(Client *c);
+void memo_teardown(void);
+
+#endif
@@ -0,0 +1,231 @@
+/* See LICENSE file for copyright and license details. */
+#include <stdlib.h>
+#include "main.h"
+#include "backend.h"
+#include "place.h"
+#include "client.h"
+#include "config.h"
+#include "geom.h"
+#include "stats.h"
+#include "log.h"
+
+#define CASCADE_STEP 32
+
+static int cmp_int32(const void *a, const void *b) {
+    const int32_t ia = *(const int32_t *)a, ib = *(const int32_t *)b;
+
+    return (ia > ib) - (ia < ib);
+}
+
+/* sort and drop duplicates and anything outside [0, max] */
+static int candidates(int32_t *v, int n, int32_t max) {
+    int m = 0;
+
+    qsort(v, n, sizeof(*v), cmp_int32);
+    for (int i = 0; i < n; i++)
+        if (v[i] >= 0 && v[i] <= max && (m == 0 || v[m - 1] != v[i]))
+            v[m++] = v[i];
+    return m;
+}
+
+/* as the new frame slides right along a row, the area it shares with
+ * another frame rises, holds and falls back to nothing: four changes of
+ * slope, by sign times the rows the two share */
+struct slope {
+    int32_t x;
+    int frame, sign;
+};
+
+static int cmp_slope(const void *a, const void *b) {
+    return cmp_int32(&((const struct slope *)a)->x,
+                     &((const struct slope *)b)->x);
+}
+
+/* try every spot where the new frame would touch the screen's edge or
+ * another frame's, top to bottom and left to right. first_fit takes the
+ * first spot covering nothing; otherwise the one covering the least.
+ * false when first_fit found nothing, or there is no room at all.
+ * a row's spots are scored in one sweep over the frames' slope changes,
+ * sorted once, rather than each spot against every frame. */
+static bool scan(Client *c, bool first_fit, int16_t *x, int16_t *y) {
+    const int32_t bw = BWIDTH(c), bh = BHEIGHT(c);
+    const int32_t sw = screen->width_in_pixels - bw;
+    const int32_t sh = screen->height_in_pixels - bh;
+    const xcb_rectangle_t on_screen = {0, 0, screen->width_in_pixels,
+                                       screen->height_in_pixels};
+    xcb_rectangle_t *frames;
+    Client **on;
+    struct slope *slopes;
+    int64_t *rows;
+    int32_t *xs, *ys;
+    int n = 0, nx = 0, ny = 0;
+    uint64_t best = UINT64_MAX;
+
+    if (sw < 0 || sh < 0)
+        return false;
+
+    /* the frames already on the workspace, shown or not. one wholly off
+     * the screen covers no spot, and its edges are nothing to line up
+     * with. */
+    if (!(on = malloc((geom_count() + 1) * sizeof(*on))))
+        err("can't allocate memory.");
+    n = geom_intersecting(&on_screen, c->ws, on);
+    if (!(frames = malloc((n + 1) * sizeof(*frames))) ||
+        !(slopes = malloc((4 * n + 1) * sizeof(*slopes))) ||
+        !(rows = malloc((n + 1) * sizeof(*rows))) ||
+        !(xs = malloc((2 * n + 2) * sizeof(*xs))) ||
+        !(ys = malloc((2 * n + 2) * sizeof(*ys))))
+        err("can't allocate memory.");
+    for (int i = 0; i < n; i++)
+        frames[i] = geom_frame(on[i]);
+
+    xs[nx++] = 0;
+    xs[nx++] = sw;
+    ys[ny++] = 0;
+    ys[ny++] = sh;
+    for (int i = 0; i < n; i++) {
+        xs[nx++] = frames[i].x + frames[i].width;
+        xs[nx++] = frames[i].x - bw;
+        ys[ny++] = frames[i].y + frames[i].height;
+        ys[ny++] = frames[i].y - bh;
+    }
+    nx = candidates(xs, nx, sw);
+    ny = candidates(ys, ny, sh);
+
+    for (int k = 0; k < n; k++) {
+        const int32_t l = frames[k].x, r = l + frames[k].width;
+        slopes[4 * k] = (struct slope){l - bw, k, 1};
+        slopes[4 * k + 1] = (struct slope){l, k, -1};
+        slopes[4 * k + 2] = (struct slope){r - bw, k, -1};
+        slopes[4 * k + 3] = (struct slope){r, k, 1};
+    }
+    qsort(slopes, 4 * n, sizeof(*slopes), cmp_slope);
+
+    for (int j = 0; j < ny && best; j++) {
+        int64_t covered = 0, slope = 0;
+        int32_t at = n ? slopes[0].x : 0;
+        int e = 0;
+
+        for (int k = 0; k < n; k++)
+            rows[k] = MAX(0, MIN(ys[j] + bh, frames[k].y + frames[k].height) -
+                                 MAX(ys[j], frames[k].y));
+        for (int i = 0; i < nx && best; i++) {
+            for (; e < 4 * n && slopes[e].x <= xs[i]; e++) {
+                covered += slope * (slopes[e].x - at);
+                at = slopes[e].x;
+                slope += slopes[e].sign * rows[slopes[e].frame];
+            }
+            covered += slope * (xs[i] - at);
+            at = xs[i];
+            if ((uint64_t)covered < best && (!first_fit || covered == 0)) {
+                best = covered;
+                *x = xs[i];
+                *y = ys[j];
+            }
+        }
+    }
+
+    FREE(on);
+    FREE(frames);
+    FREE(slopes);
+    FREE(rows);
+    FREE(xs);
+    FREE(ys);
+    return best != UINT64_MAX;
+}
+
+static void center(Client *c) {
+    c->geom.x = (screen->width_in_pixels - BWIDTH(c)) / 2;
+    c->geom.y = (screen->height_in_pixels - BHEIGHT(c)) / 2;
+}
+
+/* the pointer query place_prefetch() sent, if any */
+static unsigned int pointer;
+static bool pointer_sent;
+
+/* centered on the pointer, and kept on screen */
+static void under_pointer(Client *c) {
+    xcb_query_pointer_reply_t *r;
+
+    if (!pointer_sent)
+        place_prefetch();
+    pointer_sent = false;
+    if (!(r = backend_reply(pointer))) {
+        center(c);
+        return;
+    }
+    c->geom.x = MAX(0, MIN(r->root_x - BWIDTH(c) / 2,
+                           screen->width_in_pixels - BWIDTH(c)));
+    c->geom.y = MAX(0, MIN(r->root_y - BHEIGHT(c) / 2,
+                           screen->height_in_pixels - BHEIGHT(c)));
+    FREE(r);
+}
+
+/* each window a step down and right of the last, back to the corner
+ * when one would run off the screen */
+static void cascade(Client *c) {
+    static int32_t x, y;
+
+    if (x + BWIDTH(c) > screen->width_in_pixels ||
+        y + BHEIGHT(c) > screen->height_in_pixels)
+        x = y = 0;
+    c->geom.x = x;
+    c->geom.y = y;
+    x += CASCADE_STEP;
+    y += CASCADE_STEP;
+}
+
+/* pick a new client's position, before it has a frame, from the frames
+ * already on its workspace. the size is settled by then. */
+void place_client(Client *c) {
+    int16_t x, y;
+
+    if (c->type == WINTYPE_DIALOG) {
+        center(c);
+        return;
+    }
+
+    switch (placement) {
+    case PLACE_NONE:
+        return;
+    case PLACE_CENTER:
+        center(c);
+        break;
+    case PLACE_FIRST_FIT:
+    case PLACE_OVERLAP:
+        if (scan(c, placement == PLACE_FIRST_FIT, &x, &y)) {
+            c->geom.x = x;
+            c->geom.y = y;
+        } else {
+            center(c);
+        }
+        break;
+    case PLACE_POINTER:
+        under_pointer(c);
+        break;
+    case PLACE_CASCADE:
+        cascade(c);
+        break;
+    }
+    PRINTF("place: win %#x to (%d,%d)\n", c->win, c->geom.x, c->geom.y);
+}
+
+/* send what placing a client will ask the server, so the reply comes in
+ * with the caller's others. returns the sequence number sent, 0 if
+ * none. */
+unsigned int place_prefetch(void) {
+    if (placement != PLACE_POINTER)
+        return 0;
+    if (!pointer_sent) {
+        pointer = backend_query_pointer();
+        pointer_sent = true;
+    }
+    return pointer;
+}
+
+/* drop the reply if the client wasn't placed after all */
+void place_discard(void) {
+    if (pointer_sent)
+        backend_discard(pointer);
+    pointer_sent = false;
+}
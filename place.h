@@ -0,0 +1,20 @@
+/* See LICENSE file for copyright and license details. */
+#ifndef PLACE_H
+#define PLACE_H
+
+/* the placement option */
+enum {
+    PLACE_NONE,      /* where the window asks to be */
+    PLACE_CENTER,
+    PLACE_FIRST_FIT, /* the first free spot, else centered */
+    PLACE_OVERLAP,   /* the spot covering the least of other windows */
+    PLACE_POINTER,
+    PLACE_CASCADE,
+    PLACE_MAX
+};
+
+void place_client(Client *c);
+unsigned int place_prefetch(void);
+void place_discard(void);
+
+#endif
@@ -0,0 +1,268 @@
+/* See LICENSE file for copyright and license details. */
+#include <string.h>
+#include <xcb/xcb_icccm.h>
+#include "main.h"
+#include "backend.h"
+#include "client.h"
+#include "prop.h"
+#include "stats.h"
+#include "log.h"
+
+/* bitmap of the atoms prop_invalidate() cares about */
+static uint32_t *interest;
+static xcb_atom_t interest_max;
+
+static char *copy_name(const char *s, uint32_t len) {
+    char *name;
+    if (!(name = malloc(len + 1)))
+        err("can't allocate memory.");
+    memcpy(name, s, len);
+    name[len] = '\0';
+    return name;
+}
+
+/* clients with requests in flight, for prop_collect() */
+static Client **fetching;
+static int nfetching, fetching_size;
+
+static int bit_index(uint8_t bit) {
+    int i = 0;
+    while (!(bit & (1u << i)))
+        i++;
+    return i;
+}
+
+/* sequence numbers wrap */
+static bool seq_before(unsigned int a, unsigned int b) {
+    return (int)(a - b) < 0;
+}
+
+/* send the requests for mask without reading anything. returns the last
+ * sequence number sent, 0 if none. */
+static unsigned int prop_request(Client *c, uint8_t mask) {
+    unsigned int seq = 0;
+
+    if (!mask)
+        return 0;
+    PRINTF("prop_request: win %#x mask %#x\n", c->win, mask);
+
+    for (uint8_t bit = 1; bit < PROP_ALL; bit <<= 1) {
+        if (!(mask & bit))
+            continue;
+        /* what xcb_icccm_get_wm_*() would ask for */
+        if (bit == PROP_NORMAL_HINTS)
+            seq = backend_get_property(c->win, XCB_ATOM_WM_NORMAL_HINTS,
+                                       XCB_ATOM_WM_SIZE_HINTS,
+                                       XCB_ICCCM_NUM_WM_SIZE_HINTS_ELEMENTS);
+        else if (bit == PROP_WM_HINTS)
+            seq = backend_get_property(c->win, XCB_ATOM_WM_HINTS,
+                                       XCB_ATOM_WM_HINTS,
+                                       XCB_ICCCM_NUM_WM_HINTS_ELEMENTS);
+        else if (bit == PROP_PROTOCOLS)
+            seq = backend_get_property(c->win, WM_PROTOCOLS, XCB_ATOM_ATOM,
+                                       UINT32_MAX);
+        else if (bit == PROP_CLASS)
+            seq = backend_get_property(c->win, XCB_ATOM_WM_CLASS,
+                                       XCB_ATOM_STRING, 2048);
+        else
+            seq = backend_get_property(c->win, WM_WINDOW_ROLE,
+                                       XCB_ATOM_STRING, 64);
+        c->prop_seq[bit_index(bit)] = seq;
+    }
+
+    if (!c->fetching_props) {
+        if (nfetching == fetching_size) {
+            fetching_size = fetching_size ? fetching_size * 2 : 16;
+            if (!(fetching = realloc(fetching,
+                                     fetching_size * sizeof(*fetching))))
+                err("can't allocate memory.");
+        }
+        fetching[nfetching++] = c;
+    }
+    c->fetching_props |= mask;
+    return seq;
+}
+
+static void settle(Client *c, uint8_t bit) {
+    c->fetching_props &= ~bit;
+    if (c->fetching_props)
+        return;
+    for (int i = 0; i < nfetching; i++)
+        if (fetching[i] == c) {
+            fetching[i] = fetching[--nfetching];
+            break;
+        }
+}
+
+/* take the reply for one bit into the cache. r is NULL if the request
+ * failed, which leaves the property unset. */
+static void prop_apply(Client *c, uint8_t bit, xcb_get_property_reply_t *r) {
+    settle(c, bit);
+    c->valid_props |= bit;
+
+    if (bit == PROP_NORMAL_HINTS) {
+        xcb_size_hints_t sh;
+        if (!r || !xcb_icccm_get_wm_size_hints_from_reply(&sh, r))
+            sh.flags = 0;
+        setsizehints(c, &sh);
+    } else if (bit == PROP_WM_HINTS) {
+        xcb_icccm_wm_hints_t wmh;
+        if (r && xcb_icccm_get_wm_hints_from_reply(&wmh, r))
+            c->wm_hints = wmh.flags;
+        else
+            c->wm_hints = 0;
+        if (c->wm_hints & XCB_ICCCM_WM_HINT_X_URGENCY) {
+            PRINTF("ICCCM: Urgent win %#x\n", c->win);
+        }
+    } else if (bit == PROP_PROTOCOLS) {
+        xcb_icccm_get_wm_protocols_reply_t pr;
+        c->can_focus = c->can_delete = false;
+        if (r && xcb_icccm_get_wm_protocols_from_reply(r, &pr)) {
+            for (unsigned int i = 0; i < pr.atoms_len; ++i) {
+                if (pr.atoms[i] == WM_DELETE_WINDOW)
+                    c->can_delete = true;
+                if (pr.atoms[i] == WM_TAKE_FOCUS)
+                    c->can_focus = true;
+            }
+            /* frees r */
+            xcb_icccm_get_wm_protocols_reply_wipe(&pr);
+            return;
+        }
+    } else if (bit == PROP_CLASS) {
+        xcb_icccm_get_wm_class_reply_wipe(&c->class);
+        /* on success the class keeps r until the next wipe */
+        if (r && xcb_icccm_get_wm_class_from_reply(&c->class, r))
+            return;
+        memset(&c->class, 0, sizeof(c->class));
+    } else {
+        FREE(c->role);
+        if (r && r->format == 8 && xcb_get_property_value_length(r) > 0)
+            c->role = copy_name(xcb_get_property_value(r),
+                                xcb_get_property_value_length(r));
+    }
+    free(r);
+}
+
+/* refresh every invalid property in mask. what isn't in flight yet is
+ * sent before the first reply is read, so a batch costs at most one
+ * round trip: the wait for the last reply. */
+void prop_fetch(Client *c, uint8_t mask) {
+    unsigned int last = 0;
+    bool any = false;
+
+    mask &= ~c->valid_props;
+    if (!mask)
+        return;
+
+    prop_request(c, mask & ~c->fetching_props);
+    for (uint8_t bit = 1; bit < PROP_ALL; bit <<= 1) {
+        if (!(mask & bit))
+            continue;
+        const unsigned int seq = c->prop_seq[bit_index(bit)];
+        if (!any || seq_before(last, seq))
+            last = seq;
+        any = true;
+    }
+    stats_wait(last);
+
+    for (uint8_t bit = 1; bit < PROP_ALL; bit <<= 1) {
+        if (!(mask & bit))
+            continue;
+        prop_apply(c, bit, backend_reply(c->prop_seq[bit_index(bit)]));
+    }
+}
+
+/* send the requests for what in mask is neither cached nor in flight, for
+ * a prop_fetch() to find answered later. returns the last sequence
+ * number sent, 0 if none. */
+unsigned int prop_prefetch(Client *c, uint8_t mask) {
+    return prop_request(c, mask & ~c->valid_props & ~c->fetching_props);
+}
+
+/* take in every reply that has already arrived, without waiting for the
+ * rest */
+void prop_collect(void) {
+    for (int i = nfetching - 1; i >= 0; i--) {
+        Client *c = fetching[i];
+        for (uint8_t bit = 1; bit < PROP_ALL; bit <<= 1) {
+            void *r;
+
+            if (!(c->fetching_props & bit) ||
+                !backend_poll(c->prop_seq[bit_index(bit)], &r))
+                continue;
+            prop_apply(c, bit, r);
+        }
+    }
+}
+
+/* called when the queue is drained of the PropertyNotify for atom, whose
+ * sequence number was seq. the new value is asked for at once and read
+ * by prop_collect() or whoever needs it first. a request already in
+ * flight is kept if the server hadn't processed it when the change
+ * happened, since its reply has the new value. returns false if the atom
+ * isn't cached. */
+bool prop_invalidate(Client *c, xcb_atom_t atom, unsigned int seq) {
+    uint8_t bit;
+
+    if (atom == XCB_ATOM_WM_NORMAL_HINTS)
+        bit = PROP_NORMAL_HINTS;
+    else if (atom == XCB_ATOM_WM_HINTS)
+        bit = PROP_WM_HINTS;
+    else if (atom == WM_PROTOCOLS)
+        bit = PROP_PROTOCOLS;
+    else if (atom == XCB_ATOM_WM_CLASS)
+        bit = PROP_CLASS;
+    else if (atom == WM_WINDOW_ROLE)
+        bit = PROP_ROLE;
+    else
+        return false;
+
+    c->valid_props &= ~bit;
+    if (c->fetching_props & bit) {
+        if (seq_before(seq, c->prop_seq[bit_index(bit)]))
+            return true;
+        backend_discard(c->prop_seq[bit_index(bit)]);
+        settle(c, bit);
+    }
+    prop_request(c, bit);
+    return true;
+}
+
+void prop_setup(void) {
+    const xcb_atom_t atoms[] = {
+        XCB_ATOM_WM_NORMAL_HINTS, XCB_ATOM_WM_HINTS, WM_PROTOCOLS,
+        XCB_ATOM_WM_CLASS,        WM_WINDOW_ROLE,
+    };
+
+    interest_max = 0;
+    for (int i = 0; i < LENGTH(atoms); i++)
+        if (atoms[i] > interest_max)
+            interest_max = atoms[i];
+
+    if (!(interest = calloc(interest_max / 32 + 1, sizeof(uint32_t))))
+        err("can't allocate memory.");
+    for (int i = 0; i < LENGTH(atoms); i++)
+        interest[atoms[i] / 32] |= 1u << (atoms[i] % 32);
+}
+
+void prop_teardown(void) {
+    FREE(interest);
+    FREE(fetching);
+    nfetching = fetching_size = 0;
+}
+
+bool prop_wanted(xcb_atom_t atom) {
+    return atom <= interest_max && (interest[atom / 32] & (1u << (atom % 32)));
+}
+
+void prop_wipe(Client *c) {
+    for (uint8_t bit = 1; bit < PROP_ALL; bit <<= 1)
+        if (c->fetching_props & bit) {
+            backend_discard(c->prop_seq[bit_index(bit)]);
+            settle(c, bit);
+        }
+    xcb_icccm_get_wm_class_reply_wipe(&c->class);
+    memset(&c->class, 0, sizeof(c->class));
+    FREE(c->role);
+    c->valid_props = 0;
+}
@@ -0,0 +1,24 @@
+/* See LICENSE file for copyright and license details. */
+#ifndef PROP_H
+#define PROP_H
+
+/* cached client properties, one validity bit each */
+enum {
+    PROP_NORMAL_HINTS = (1 << 0),
+    PROP_WM_HINTS = (1 << 1),
+    PROP_PROTOCOLS = (1 << 2),
+    PROP_CLASS = (1 << 3),
+    PROP_ROLE = (1 << 4),
+    PROP_ALL = (1 << 5) - 1
+};
+
+void prop_setup(void);
+void prop_teardown(void);
+void prop_fetch(Client *c, uint8_t mask);
+unsigned int prop_prefetch(Client *c, uint8_t mask);
+void prop_collect(void);
+bool prop_invalidate(Client *c, xcb_atom_t atom, unsigned int seq);
+bool prop_wanted(xcb_atom_t atom);
+void prop_wipe(Client *c);
+
+#endif
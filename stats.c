@@ -0,0 +1,423 @@
+/* See LICENSE file for copyright and license details. */
+#include <sys/resource.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <xcb/xcb_event.h>
+#include "main.h"
+#include "backend.h"
+#include "client.h"
+#include "cursor.h"
+#include "list.h"
+#include "launch.h"
+#include "stats.h"
+#include "watchdog.h"
+#include "log.h"
+
+/* log-linear buckets: four per power of two, so any value is within 25%
+ * of its bucket's floor. the last bucket takes everything from ~480s. */
+#define SUB_BITS 2
+#define SUBS (1 << SUB_BITS)
+#define BUCKETS (38 * SUBS)
+
+static struct {
+    uint32_t count;
+    uint32_t hist[BUCKETS];
+    uint64_t total;
+    uint64_t max;
+    uint64_t requests;
+    uint64_t waits;
+    uint32_t max_waits;
+} sections[STAT_SECTIONS];
+
+/* round trips a section may cost, checked by bench/run.sh against the
+ * dump. debug builds also report going over as it happens. manage sends
+ * everything it asks before it waits. */
+static const struct {
+    int section;
+    uint32_t waits;
+} budgets[] = {
+    {XCB_KEY_PRESS, 0},
+    {XCB_ENTER_NOTIFY, 0},
+    {STAT_FOCUS, 0},
+    {STAT_MANAGE, 1},
+};
+
+/* NoOp requests sent to read the sequence, and blocking replies waited on */
+static uint32_t marks, waits;
+static unsigned int last_wait;
+static int active = -1;
+
+/* input latency per action: from the server's timestamp on the input
+ * event to the end of its handling. needs a server whose clock is ours,
+ * as a local Xorg or Xvfb's monotonic milliseconds are. */
+#define INPUT_MAX 16
+#define INPUT_SKEW_MS 60000
+
+static struct {
+    const char *action;
+    uint32_t count;
+    uint32_t hist[BUCKETS];
+    uint64_t max;
+} inputs[INPUT_MAX];
+static uint32_t inputs_skipped;
+
+/* events handled per drain of the queue, in power of two buckets */
+static struct {
+    uint32_t count;
+    uint32_t hist[17];
+    uint32_t max;
+    uint64_t total;
+} drains;
+
+static int bucket(uint64_t v) {
+    if (v < SUBS)
+        return (int)v;
+    const int msb = 63 - __builtin_clzll(v);
+    const int i = (msb - SUB_BITS + 1) * SUBS +
+                  (int)((v >> (msb - SUB_BITS)) & (SUBS - 1));
+    return i < BUCKETS ? i : BUCKETS - 1;
+}
+
+static uint64_t bucket_floor(int i) {
+    if (i < SUBS)
+        return (uint64_t)i;
+    return (uint64_t)(SUBS + i % SUBS) << (i / SUBS - 1);
+}
+
+/* the bucket holding the pct'th percentile */
+static int hist_percentile(const uint32_t *hist, int n, uint32_t count,
+                           unsigned int pct) {
+    uint64_t seen = 0;
+    const uint64_t want = ((uint64_t)count * pct + 99) / 100;
+
+    for (int i = 0; i < n; i++)
+        if ((seen += hist[i]) >= want)
+            return i;
+    return n - 1;
+}
+
+const char *stats_section_name(int i) {
+    switch (i) {
+    case 0:
+        return "Error";
+    STAT_LIST(STAT_CASE)
+    default:
+        return xcb_event_get_label(i);
+    }
+}
+
+/* nanoseconds on the monotonic clock */
+uint64_t stats_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* the sequence number of the next request, read off a NoOp. it costs
+ * four bytes in the output buffer, flushed with the rest, and never a
+ * reply. */
+static unsigned int mark(void) {
+    marks++;
+    return backend_noop();
+}
+
+/* the budget for a section, or -1 */
+static int budget(int section) {
+    for (int i = 0; i < LENGTH(budgets); i++)
+        if (budgets[i].section == section)
+            return (int)budgets[i].waits;
+    return -1;
+}
+
+void stats_start(StatsMark *m, int section) {
+    m->seq = mark();
+    m->marks = marks;
+    m->waits = waits;
+    m->section = section;
+    m->outer = __atomic_load_n(&active, __ATOMIC_RELAXED);
+    __atomic_store_n(&active, section, __ATOMIC_RELAXED);
+    m->time = stats_now();
+}
+
+/* account the time, requests and round trips since m to its section.
+ * returns the time. */
+uint64_t stats_record(const StatsMark *m) {
+    const int section = m->section;
+    const uint64_t ns = stats_now() - m->time;
+
+    __atomic_store_n(&active, m->outer, __ATOMIC_RELAXED);
+    /* our own NoOps, including those of nested sections, don't count */
+    const unsigned int seq = mark();
+    const uint32_t requests = seq - m->seq - (marks - m->marks);
+    const uint32_t w = waits - m->waits;
+
+    sections[section].count++;
+    sections[section].hist[bucket(ns)]++;
+    sections[section].total += ns;
+    if (ns > sections[section].max)
+        sections[section].max = ns;
+    sections[section].requests += requests;
+    sections[section].waits += w;
+    if (w > sections[section].max_waits)
+        sections[section].max_waits = w;
+
+#ifdef DEBUG
+    const int b = budget(section);
+    if (b >= 0 && w > (uint32_t)b)
+        PRINTF("stats: %s took %u round trips, budget %d\n",
+               stats_section_name(section), w, b);
+#endif
+    return ns;
+}
+
+/* call before blocking on the reply to request seq. replies arrive in
+ * order, so only a wait past the last one waited on is a round trip; a
+ * batch waits for its last request first and counts once. */
+void stats_wait(unsigned int seq) {
+    if ((int)(seq - last_wait) <= 0)
+        return;
+    __atomic_store_n(&last_wait, seq, __ATOMIC_RELAXED);
+    waits++;
+}
+
+/* actions are static strings, so the pointer is the key */
+void stats_input(const char *action, xcb_timestamp_t time) {
+    const uint32_t now = stats_now() / 1000000;
+    const uint32_t ms = now - time;
+    int i;
+
+    if (ms > INPUT_SKEW_MS) {
+        inputs_skipped++;
+        return;
+    }
+    for (i = 0; i < INPUT_MAX && inputs[i].action; i++)
+        if (inputs[i].action == action)
+            break;
+    if (i == INPUT_MAX)
+        return;
+
+    const uint64_t ns = (uint64_t)ms * 1000000;
+    inputs[i].action = action;
+    inputs[i].count++;
+    inputs[i].hist[bucket(ns)]++;
+    if (ns > inputs[i].max)
+        inputs[i].max = ns;
+}
+
+/* the innermost section running, or -1, and the last reply waited on.
+ * safe to call from another thread. */
+int stats_active(unsigned int *wait) {
+    *wait = __atomic_load_n(&last_wait, __ATOMIC_RELAXED);
+    return __atomic_load_n(&active, __ATOMIC_RELAXED);
+}
+
+void stats_drain(unsigned int depth) {
+    int i = 0;
+    while (i < 16 && (1u << i) < depth)
+        i++;
+    drains.count++;
+    drains.hist[i]++;
+    drains.total += depth;
+    if (depth > drains.max)
+        drains.max = depth;
+}
+
+static void sections_dump(FILE *out, FILE *tsv) {
+    fprintf(out, "handler latency (ns)     count     mean      p50      p99"
+                 "      max  req/call  rt/call  max rt\n");
+    if (tsv)
+        fprintf(tsv, "section\tcount\tmean_ns\tp50_ns\tp99_ns\tmax_ns\t"
+                     "requests\tround_trips\tmax_round_trips\tbudget\n");
+
+    for (int i = 0; i < STAT_SECTIONS; i++) {
+        const uint32_t n = sections[i].count;
+        char req[16], total[24], limit[16] = "";
+        if (!n)
+            continue;
+        snprintf(req, sizeof(req), "%.2f", (double)sections[i].requests / n);
+        snprintf(total, sizeof(total), "%llu",
+                 (unsigned long long)sections[i].requests);
+        if (budget(i) >= 0)
+            snprintf(limit, sizeof(limit), "%d", budget(i));
+        const unsigned long long mean = sections[i].total / n,
+                                 max = sections[i].max;
+        const unsigned long long p50 = bucket_floor(
+            hist_percentile(sections[i].hist, BUCKETS, n, 50));
+        const unsigned long long p99 = bucket_floor(
+            hist_percentile(sections[i].hist, BUCKETS, n, 99));
+        fprintf(out, "  %-20s %8u %8llu %8llu %8llu %8llu %9s %8.2f %7u\n",
+                stats_section_name(i), n, mean, p50, p99, max, req,
+                (double)sections[i].waits / n, sections[i].max_waits);
+        if (tsv)
+            fprintf(tsv, "%s\t%u\t%llu\t%llu\t%llu\t%llu\t%s\t%llu\t%u\t%s\n",
+                    stats_section_name(i), n, mean, p50, p99, max, total,
+                    (unsigned long long)sections[i].waits,
+                    sections[i].max_waits, limit);
+    }
+
+    if (inputs[0].action || inputs_skipped)
+        fprintf(out, "input latency (ms)       count      p50      p99      "
+                     "max  (%u skipped: server clock differs)\n",
+                inputs_skipped);
+    for (int i = 0; i < INPUT_MAX && inputs[i].action; i++) {
+        const uint32_t n = inputs[i].count;
+        const int p50 = hist_percentile(inputs[i].hist, BUCKETS, n, 50);
+        const int p99 = hist_percentile(inputs[i].hist, BUCKETS, n, 99);
+        const unsigned long long ms50 = bucket_floor(p50) / 1000000,
+                                 ms99 = bucket_floor(p99) / 1000000,
+                                 max = inputs[i].max / 1000000;
+        fprintf(out, "  %-20s %8u %8llu %8llu %8llu\n", inputs[i].action, n,
+                ms50, ms99, max);
+        if (tsv)
+            fprintf(tsv, "input %s\t%u\t\t%llu\t%llu\t%llu\n",
+                    inputs[i].action, n, ms50 * 1000000, ms99 * 1000000,
+                    max * 1000000);
+    }
+
+    uint32_t count;
+    const size_t size = clients_size(&count);
+    fprintf(out, "clients: %u, %zu bytes, %zu per client\n", count, size,
+            count ? size / count : 0);
+    if (tsv)
+        fprintf(tsv, "clients\t%u\t%zu\n", count, size);
+
+    if (!drains.count)
+        return;
+    fprintf(out, "queue depth: %u drains, mean %.1f, max %u\n ", drains.count,
+            (double)drains.total / drains.count, drains.max);
+    for (int i = 0; i < 17; i++)
+        if (drains.hist[i])
+            fprintf(out, " <=%u:%u", 1u << i, drains.hist[i]);
+    fprintf(out, "\n");
+    /* depths are bucketed as <= 2^i, so percentiles are upper bounds */
+    if (tsv)
+        fprintf(tsv, "drains\t%u\t%llu\t%u\t%u\t%u\n", drains.count,
+                (unsigned long long)(drains.total / drains.count),
+                1u << hist_percentile(drains.hist, 17, drains.count, 50),
+                1u << hist_percentile(drains.hist, 17, drains.count, 99),
+                drains.max);
+}
+
+/* where dumps go: $XDG_RUNTIME_DIR, else a directory of our own made
+ * under /tmp on first use, where no one else can leave a link to a file
+ * for a dump to clobber. NULL if neither will do. */
+const char *stats_dir(void) {
+    static char own[64];
+    const char *dir = getenv("XDG_RUNTIME_DIR");
+
+    if (dir && *dir)
+        return dir;
+    if (!own[0]) {
+        snprintf(own, sizeof(own), "/tmp/" __WM_NAME__ "-XXXXXX");
+        if (!mkdtemp(own)) {
+            warn("stats: can't make a directory for dumps\n");
+            own[0] = '\0';
+            return NULL;
+        }
+        warn("stats: no XDG_RUNTIME_DIR, dumps go to %s\n", own);
+    }
+    return own;
+}
+
+static FILE *open_tsv(const char *what, bool append) {
+    const char *dir = stats_dir();
+    const int flags = O_WRONLY | O_CREAT | O_NOFOLLOW | O_CLOEXEC |
+                      (append ? O_APPEND : O_TRUNC);
+    char path[256];
+    FILE *f = NULL;
+    int fd;
+
+    if (!dir)
+        return NULL;
+    snprintf(path, sizeof(path), "%s/" __WM_NAME__ "-%s.tsv", dir, what);
+    if ((fd = open(path, flags, 0600)) == -1 ||
+        !(f = fdopen(fd, append ? "a" : "w"))) {
+        warn("stats: can't write %s\n", path);
+        if (fd != -1)
+            close(fd);
+    }
+    return f;
+}
+
+/* the machine-readable side of a dump: tfwm-<what>.tsv in stats_dir(),
+ * rewritten on every dump */
+FILE *stats_open(const char *what) {
+    return open_tsv(what, false);
+}
+
+/* resident set in kB, from /proc where there is one */
+static unsigned long rss_kb(void) {
+    unsigned long pages = 0;
+    FILE *f;
+
+    if (!(f = fopen("/proc/self/statm", "r")))
+        return 0;
+    if (fscanf(f, "%*u %lu", &pages) != 1)
+        pages = 0;
+    fclose(f);
+    return pages * (unsigned long)(sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/* what a long session holds, in memory and on the server. the tsv is
+ * appended to, a row per dump, so growth shows up over a day of dumps. */
+static void resources_dump(FILE *out, FILE *tsv) {
+    struct rusage ru;
+    unsigned int keys, buttons, framed = 0;
+    uint32_t count;
+    const size_t size = clients_size(&count);
+    const unsigned long rss = rss_kb();
+    const int cursors = cursor_count();
+    /* the requests sent so far, our own NoOps aside */
+    const unsigned int seq = mark();
+    const uint32_t requests = seq - marks;
+
+    if (getrusage(RUSAGE_SELF, &ru) == -1)
+        ru.ru_maxrss = 0;
+    backend_grabs(&keys, &buttons);
+    for (Client *c = clients; c; c = c->next)
+        if (!ISUNFRAMED(c))
+            framed++;
+
+    fprintf(out,
+            "resources: rss %lu kB (peak %ld kB), %u clients (%u framed), "
+            "%zu bytes, %u key grabs, %u button grabs, %d cursors, "
+            "%u requests\n",
+            rss, ru.ru_maxrss, count, framed, size, keys, buttons, cursors,
+            requests);
+    if (!tsv)
+        return;
+    if (ftell(tsv) == 0)
+        fprintf(tsv, "time\trss_kb\tpeak_kb\tclients\tframes\tbytes\t"
+                     "key_grabs\tbutton_grabs\tcursors\trequests\n");
+    fprintf(tsv, "%llu\t%lu\t%ld\t%u\t%u\t%zu\t%u\t%u\t%d\t%u\n",
+            (unsigned long long)(stats_now() / 1000000000), rss, ru.ru_maxrss,
+            count, framed, size, keys, buttons, cursors, requests);
+}
+
+/* SIGUSR1: human-readable to stderr, tab-separated to the stats files */
+void stats_dump(void) {
+    FILE *f;
+
+    f = stats_open("events");
+    sections_dump(stderr, f);
+    if (f)
+        fclose(f);
+
+    f = stats_open("launch");
+    launch_dump(stderr, f);
+    if (f)
+        fclose(f);
+
+    f = stats_open("watchdog");
+    watchdog_dump(stderr, f);
+    if (f)
+        fclose(f);
+
+    f = open_tsv("resources", true);
+    resources_dump(stderr, f);
+    if (f)
+        fclose(f);
+}
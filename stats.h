@@ -0,0 +1,53 @@
+/* See LICENSE file for copyright and license details. */
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+
+/* timed sections past the core X event types, and their names. shared
+ * with tools/trace.c. */
+#define STAT_LIST(X)                                                         \
+    X(STAT_OTHER, "(extension)") /* extension events */                      \
+    X(STAT_MANAGE, "manage")                                                 \
+    X(STAT_FOCUS, "focus")                                                   \
+    X(STAT_PENDING, "pending")                                               \
+    X(STAT_UNMANAGE, "unmanage")                                             \
+    X(STAT_WORKSPACE, "workspace")                                           \
+    X(STAT_CYCLE, "cycle")
+
+#define STAT_ENUM(id, name) id,
+#define STAT_CASE(id, name)                                                  \
+    case id:                                                                 \
+        return name;
+
+/* timed sections: the core X event types by number, then the rest */
+enum {
+    STAT_CORE_LAST = XCB_GE_GENERIC,
+    STAT_LIST(STAT_ENUM)
+    STAT_SECTIONS
+};
+
+/* where a timed section started: the clock, the request sequence and
+ * the round trip count */
+typedef struct {
+    uint64_t time;
+    unsigned int seq;
+    uint32_t marks;
+    uint32_t waits;
+    int section;
+    int outer; /* the section this one is nested in */
+} StatsMark;
+
+uint64_t stats_now(void);
+void stats_start(StatsMark *m, int section);
+uint64_t stats_record(const StatsMark *m);
+void stats_wait(unsigned int seq);
+void stats_input(const char *action, xcb_timestamp_t time);
+int stats_active(unsigned int *wait);
+const char *stats_section_name(int section);
+void stats_drain(unsigned int depth);
+const char *stats_dir(void);
+FILE *stats_open(const char *what);
+void stats_dump(void);
+
+#endif
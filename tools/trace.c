@@ -0,0 +1,227 @@
+/* See LICENSE file for copyright and license details. */
+/* decode a flight recorder dump or a $TFWM_CAPTURE file. atom names are
+ * looked up on $DISPLAY, which has to be the server the trace was
+ * recorded on. */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xcb/xcb.h>
+#include <xcb/xcb_event.h>
+#include "../stats.h"
+#include "../trace.h"
+
+static xcb_connection_t *conn;
+
+static const char *section_name(int i) {
+    switch (i) {
+    STAT_LIST(STAT_CASE)
+    default:
+        return "?";
+    }
+}
+
+static void print_atom(xcb_atom_t atom) {
+    xcb_get_atom_name_reply_t *r = NULL;
+
+    if (conn)
+        r = xcb_get_atom_name_reply(conn, xcb_get_atom_name(conn, atom), NULL);
+    if (r) {
+        printf(" %.*s", xcb_get_atom_name_name_length(r),
+               xcb_get_atom_name_name(r));
+        free(r);
+    } else {
+        printf(" atom %u", atom);
+    }
+}
+
+static void print_record(const struct trace_record *r, uint64_t now) {
+    printf("%12.3f ms %7.1f us  ", (double)(int64_t)(r->time - now) / 1e6,
+           r->duration / 1e3);
+
+    if (r->kind == TRACE_SECTION) {
+        printf("[%s] win %#x\n", section_name(r->type), r->window);
+        return;
+    }
+
+    if (r->type == 0)
+        printf("Error seq %u: %s, %s on %#x\n", r->seq,
+               xcb_event_get_request_label(r->detail >> 8),
+               xcb_event_get_error_label(r->detail & 0xff), r->window);
+    else
+        printf("%s seq %u win %#x", xcb_event_get_label(r->type), r->seq,
+               r->window);
+
+    switch (r->type) {
+    case 0:
+        return;
+    case XCB_PROPERTY_NOTIFY:
+    case XCB_CLIENT_MESSAGE:
+        print_atom(r->detail);
+        break;
+    case XCB_KEY_PRESS:
+        printf(" keycode %u", r->detail);
+        break;
+    case XCB_BUTTON_PRESS:
+        printf(" button %u", r->detail);
+        break;
+    case XCB_CONFIGURE_REQUEST:
+        printf(" mask %#x", r->detail);
+        break;
+    }
+    printf("\n");
+}
+
+static void print_bytes(const uint8_t *data, uint32_t size) {
+    for (uint32_t i = 0; i < size; i++)
+        printf(i % 16 == 0 ? "    %02x" : i % 16 == 15 ? " %02x\n" : " %02x",
+               data[i]);
+    if (size % 16)
+        printf("\n");
+}
+
+static const char *answer_name(uint8_t request) {
+    switch (request) {
+    case CAPTURE_WAIT:
+        return "event waited for";
+    case CAPTURE_NEW_ID:
+        return "new id";
+    case CAPTURE_KEYSYM:
+        return "keysym";
+    case CAPTURE_KEYCODES:
+        return "keycodes";
+    default:
+        return xcb_event_get_request_label(request);
+    }
+}
+
+/* what a replay reads, under -x */
+static void print_entry(const struct capture_entry *e, const uint8_t *data) {
+    switch (e->kind) {
+    case CAPTURE_SESSION: {
+        struct capture_session session;
+        if (e->size < sizeof(session))
+            return;
+        memcpy(&session, data, sizeof(session));
+        printf("  session root %#x %ux%u\n", session.root, session.width,
+               session.height);
+        return;
+    }
+    case CAPTURE_MANAGE:
+        printf("  manage win %#x\n", e->window);
+        return;
+    case CAPTURE_READY:
+        printf("  ready\n");
+        return;
+    case CAPTURE_EVENT:
+        printf("  %s\n", xcb_event_get_label(data[0] & ~0x80));
+        break;
+    case CAPTURE_DRAINED:
+        printf("  drained\n");
+        return;
+    case CAPTURE_ASK:
+        printf("  ask %s seq %u win %#x", answer_name(e->request), e->seq,
+               e->window);
+        if (e->atom)
+            print_atom(e->atom);
+        printf("\n");
+        return;
+    case CAPTURE_ANSWER:
+        if (e->request)
+            printf("  answer %s %#x\n", answer_name(e->request), e->window);
+        else
+            printf("  answer seq %u\n", e->seq);
+        break;
+    }
+    print_bytes(data, e->size);
+}
+
+static bool read_header(FILE *f, struct trace_header *h) {
+    if (fread(h, sizeof(*h), 1, f) != 1)
+        return false;
+    if (memcmp(h->magic, TRACE_MAGIC, sizeof(h->magic)) == 0)
+        return h->size == sizeof(struct trace_record);
+    if (memcmp(h->magic, CAPTURE_MAGIC, sizeof(h->magic)) == 0)
+        return h->size == sizeof(struct capture_entry);
+    return false;
+}
+
+/* a capture is one session per restart, each with its own header. -x
+ * adds what the handlers were given, in the order they took it: the
+ * events, the reads and their answers. */
+static void print_capture(FILE *f, uint64_t now, bool bytes) {
+    struct capture_entry e;
+    struct trace_header h;
+    struct trace_record r;
+    char magic[sizeof(h.magic)];
+    uint8_t *data = NULL;
+
+    printf("capture, times relative to the start of each session\n");
+    while (fread(magic, sizeof(magic), 1, f) == 1) {
+        fseek(f, -(long)sizeof(magic), SEEK_CUR);
+        if (memcmp(magic, CAPTURE_MAGIC, sizeof(magic)) == 0) {
+            if (!read_header(f, &h))
+                break;
+            now = h.now;
+            printf("-- restart\n");
+            continue;
+        }
+        if (fread(&e, sizeof(e), 1, f) != 1 ||
+            !(data = realloc(data, e.size + 1)) ||
+            (e.size > 0 && fread(data, e.size, 1, f) != 1))
+            break;
+        if (e.kind == CAPTURE_TRACE && e.size == sizeof(r)) {
+            memcpy(&r, data, sizeof(r));
+            print_record(&r, now);
+        } else if (bytes) {
+            print_entry(&e, data);
+        }
+    }
+    free(data);
+}
+
+int main(int argc, char **argv) {
+    struct trace_header h;
+    struct trace_record r;
+    bool bytes = false;
+    FILE *f;
+
+    if (argc == 3 && strcmp(argv[1], "-x") == 0) {
+        bytes = true;
+        argv++;
+        argc--;
+    }
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s [-x] trace.bin|capture\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (!(f = fopen(argv[1], "rb"))) {
+        perror(argv[1]);
+        return EXIT_FAILURE;
+    }
+    if (!read_header(f, &h)) {
+        fprintf(stderr, "%s: not a trace from this version\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    conn = xcb_connect(NULL, NULL);
+    if (xcb_connection_has_error(conn)) {
+        xcb_disconnect(conn);
+        conn = NULL;
+    }
+
+    if (h.count == 0 &&
+        memcmp(h.magic, CAPTURE_MAGIC, sizeof(h.magic)) == 0) {
+        print_capture(f, h.now, bytes);
+    } else {
+        printf("%u records, times relative to the dump\n", h.count);
+        for (uint32_t i = 0; i < h.count && fread(&r, sizeof(r), 1, f) == 1;
+             i++)
+            print_record(&r, h.now);
+    }
+
+    if (conn)
+        xcb_disconnect(conn);
+    fclose(f);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,310 @@
+/* See LICENSE file for copyright and license details. */
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "main.h"
+#include "config.h"
+#include "keys.h"
+#include "stats.h"
+#include "trace.h"
+#include "log.h"
+
+/* the last TRACE_MAX records. there is one writer, the event loop. a
+ * dump, from a signal handler or the watchdog thread, copies the ring to
+ * snap and then drops the oldest records the writer may have started to
+ * overwrite meanwhile, so none comes out torn. one dump at a time. */
+#define TRACE_MAX 4096
+
+static struct trace_record ring[TRACE_MAX];
+static uint32_t head;
+static struct trace_record snap[TRACE_MAX];
+static int dumping;
+static char path[256];
+
+/* with $TFWM_CAPTURE set, every record also goes to that file, and so
+ * does what a replay needs to take tfwm through the session again: the
+ * events as they came off the wire, and every answer the backend got,
+ * with the read it answers. */
+static FILE *capture;
+
+static void capture_write(const struct capture_entry *e, const void *data) {
+    /* stdio buffers this, so an entry costs a memcpy or two until the
+     * buffer fills */
+    if (fwrite(e, sizeof(*e), 1, capture) != 1 ||
+        (e->size > 0 && fwrite(data, e->size, 1, capture) != 1)) {
+        warn("capture: write failed, stopping.\n");
+        fclose(capture);
+        capture = NULL;
+    }
+}
+
+static void put(uint8_t kind, uint8_t type, uint16_t seq, uint32_t win,
+                uint32_t detail, uint64_t start, uint64_t duration) {
+    const uint32_t h = __atomic_load_n(&head, __ATOMIC_RELAXED);
+    struct trace_record *r = &ring[h % TRACE_MAX];
+
+    /* head is seen at h before the slot changes */
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    r->time = start;
+    r->duration = duration > UINT32_MAX ? UINT32_MAX : (uint32_t)duration;
+    r->window = win;
+    r->detail = detail;
+    r->seq = seq;
+    r->type = type;
+    r->kind = kind;
+    __atomic_store_n(&head, h + 1, __ATOMIC_RELEASE);
+
+    if (capture)
+        trace_capture(CAPTURE_TRACE, XCB_NONE, r, sizeof(*r));
+}
+
+void trace_event(const xcb_generic_event_t *ev, uint64_t start,
+                 uint64_t duration) {
+    const uint8_t type = ev->response_type & ~0x80;
+    uint32_t win = XCB_NONE, detail = 0;
+
+    switch (type) {
+    case 0: {
+        const xcb_generic_error_t *e = (const xcb_generic_error_t *)ev;
+        win = e->resource_id;
+        detail = e->error_code | e->major_code << 8;
+        break;
+    }
+    case XCB_KEY_PRESS: {
+        const xcb_key_press_event_t *e = (const xcb_key_press_event_t *)ev;
+        win = e->event;
+        detail = e->detail;
+        break;
+    }
+    case XCB_BUTTON_PRESS: {
+        const xcb_button_press_event_t *e =
+            (const xcb_button_press_event_t *)ev;
+        win = e->event;
+        detail = e->detail;
+        break;
+    }
+    case XCB_ENTER_NOTIFY:
+        win = ((const xcb_enter_notify_event_t *)ev)->event;
+        break;
+    case XCB_CONFIGURE_REQUEST: {
+        const xcb_configure_request_event_t *e =
+            (const xcb_configure_request_event_t *)ev;
+        win = e->window;
+        detail = e->value_mask;
+        break;
+    }
+    case XCB_MAP_REQUEST:
+        win = ((const xcb_map_request_event_t *)ev)->window;
+        break;
+    case XCB_UNMAP_NOTIFY:
+        win = ((const xcb_unmap_notify_event_t *)ev)->window;
+        break;
+    case XCB_DESTROY_NOTIFY:
+        win = ((const xcb_destroy_notify_event_t *)ev)->window;
+        break;
+    case XCB_GRAVITY_NOTIFY:
+        win = ((const xcb_gravity_notify_event_t *)ev)->window;
+        break;
+    case XCB_PROPERTY_NOTIFY: {
+        const xcb_property_notify_event_t *e =
+            (const xcb_property_notify_event_t *)ev;
+        win = e->window;
+        detail = e->atom;
+        break;
+    }
+    case XCB_CLIENT_MESSAGE: {
+        const xcb_client_message_event_t *e =
+            (const xcb_client_message_event_t *)ev;
+        win = e->window;
+        detail = e->type;
+        break;
+    }
+    }
+
+    put(TRACE_EVENT, type, ev->sequence, win, detail, start, duration);
+}
+
+void trace_section(int section, xcb_window_t win, uint64_t start,
+                   uint64_t duration) {
+    put(TRACE_SECTION, section, 0, win, 0, start, duration);
+}
+
+/* an event is kept as it came off the wire, GenericEvent tails aside */
+void trace_capture(uint8_t kind, xcb_window_t win, const void *data,
+                   uint32_t size) {
+    const struct capture_entry e = {.size = size, .window = win,
+                                    .kind = kind};
+
+    if (capture)
+        capture_write(&e, data);
+}
+
+void trace_ask(uint8_t request, unsigned int seq, xcb_window_t win,
+               xcb_atom_t atom) {
+    const struct capture_entry e = {.window = win, .atom = atom,
+                                    .seq = seq, .kind = CAPTURE_ASK,
+                                    .request = request};
+
+    if (capture)
+        capture_write(&e, NULL);
+}
+
+/* a reply as it came, 0 bytes for an error */
+void trace_answer(uint8_t request, unsigned int seq, uint32_t key,
+                  const void *data, uint32_t size) {
+    const struct capture_entry e = {.size = size, .window = key,
+                                    .seq = seq, .kind = CAPTURE_ANSWER,
+                                    .request = request};
+
+    if (capture)
+        capture_write(&e, data);
+}
+
+/* the atoms, screen and keyboard setup found, before the windows already
+ * there are managed */
+void trace_session(void) {
+    const size_t from = offsetof(xcb_ewmh_connection_t, _NET_SUPPORTED);
+    const struct capture_session s = {
+        .root = screen->root,
+        .width = screen->width_in_pixels,
+        .height = screen->height_in_pixels,
+        .numlockmask = numlockmask,
+        .focus_pixel = focus_pixel,
+        .unfocus_pixel = unfocus_pixel,
+        .wm_delete_window = WM_DELETE_WINDOW,
+        .wm_take_focus = WM_TAKE_FOCUS,
+        .wm_protocols = WM_PROTOCOLS,
+        .net_startup_id = NET_STARTUP_ID,
+        .wm_window_role = WM_WINDOW_ROLE,
+        .natoms = (sizeof(*ewmh) - from) / sizeof(xcb_atom_t),
+    };
+    uint8_t buf[sizeof(s) + sizeof(*ewmh) -
+                offsetof(xcb_ewmh_connection_t, _NET_SUPPORTED)];
+
+    if (!capture)
+        return;
+    memcpy(buf, &s, sizeof(s));
+    memcpy(buf + sizeof(s), (const uint8_t *)ewmh + from,
+           sizeof(buf) - sizeof(s));
+    trace_capture(CAPTURE_SESSION, XCB_NONE, buf, sizeof(buf));
+}
+
+static void write_all(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    ssize_t n;
+
+    while (len > 0) {
+        if ((n = write(fd, p, len)) == -1) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        p += n;
+        len -= n;
+    }
+}
+
+/* async-signal-safe: open, write, memcpy and clock_gettime only */
+void trace_dump(void) {
+    struct trace_header h;
+    int64_t lost;
+    int fd;
+
+    if (__atomic_exchange_n(&dumping, 1, __ATOMIC_ACQUIRE))
+        return;
+
+    /* oldest first */
+    const uint32_t end = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+    const uint32_t count = end < TRACE_MAX ? end : TRACE_MAX;
+    const uint32_t first = end - count;
+    for (uint32_t i = 0; i < count; i++)
+        snap[i] = ring[(first + i) % TRACE_MAX];
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    /* the writer is at most at the slot of record after, which held
+     * record after - TRACE_MAX */
+    const uint32_t after = __atomic_load_n(&head, __ATOMIC_RELAXED);
+    lost = (int64_t)after - TRACE_MAX - first + 1;
+    lost = lost < 0 ? 0 : lost > count ? count : lost;
+
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC,
+              0600);
+    if (fd != -1) {
+        memcpy(h.magic, TRACE_MAGIC, sizeof(h.magic));
+        h.count = count - lost;
+        h.size = sizeof(struct trace_record);
+        h.now = stats_now();
+        write_all(fd, &h, sizeof(h));
+        write_all(fd, &snap[lost], (count - lost) * sizeof(snap[0]));
+        close(fd);
+    }
+    __atomic_store_n(&dumping, 0, __ATOMIC_RELEASE);
+}
+
+static void sigdump(int sig) {
+    const int saved_errno = errno;
+
+    trace_dump();
+    errno = saved_errno;
+
+    /* crash signals were installed with SA_RESETHAND: die as we would have */
+    if (sig != SIGUSR2)
+        raise(sig);
+}
+
+static void capture_open(const char *file) {
+    struct trace_header h;
+
+    /* appended to, so a restart adds a session instead of clobbering */
+    if (!(capture = fopen(file, "ab"))) {
+        warn("capture: can't open %s.\n", file);
+        return;
+    }
+    /* not for the launch helper or anything it starts */
+    fcntl(fileno(capture), F_SETFD, FD_CLOEXEC);
+
+    memcpy(h.magic, CAPTURE_MAGIC, sizeof(h.magic));
+    h.count = 0; /* until end of file */
+    h.size = sizeof(struct capture_entry);
+    h.now = stats_now();
+    if (fwrite(&h, sizeof(h), 1, capture) != 1) {
+        warn("capture: write failed.\n");
+        fclose(capture);
+        capture = NULL;
+    }
+}
+
+/* SIGUSR2 writes the trace. so does a crash, on its way down, unless the
+ * watchdog is writing it just then. */
+void trace_setup(void) {
+    const char *dir = stats_dir();
+    const char *file = getenv("TFWM_CAPTURE");
+    const int crashes[] = {SIGSEGV, SIGBUS, SIGABRT, SIGFPE, SIGILL};
+    struct sigaction sa = {.sa_handler = sigdump, .sa_flags = SA_RESTART};
+
+    if (dir)
+        snprintf(path, sizeof(path), "%s/" __WM_NAME__ "-trace.bin", dir);
+
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGUSR2, &sa, NULL) == -1)
+        warn("failed to add SIGUSR2 handler.\n");
+
+    sa.sa_flags = SA_RESETHAND | SA_NODEFER;
+    for (int i = 0; i < LENGTH(crashes); i++)
+        if (sigaction(crashes[i], &sa, NULL) == -1)
+            warn("failed to add handler for signal %d.\n", crashes[i]);
+
+    if (file && *file)
+        capture_open(file);
+}
+
+void trace_teardown(void) {
+    if (capture) {
+        fclose(capture);
+        capture = NULL;
+    }
+}
@@ -0,0 +1,92 @@
+/* See LICENSE file for copyright and license details. */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <xcb/xcb.h>
+
+#define TRACE_MAGIC "TFWMTRC1"
+#define CAPTURE_MAGIC "TFWMCAP2"
+#define CAPTURE_EVENT_SIZE 32
+
+enum { TRACE_EVENT, TRACE_SECTION };
+
+/* one handled event or timed section. the layout is the file format. */
+struct trace_record {
+    uint64_t time;     /* monotonic ns at the start */
+    uint32_t duration; /* ns */
+    uint32_t window;
+    uint32_t detail; /* atom, keycode, button, value mask or error */
+    uint16_t seq;    /* the event's sequence number */
+    uint8_t type;    /* event type, or a STAT_* section */
+    uint8_t kind;
+};
+
+struct trace_header {
+    char magic[8];
+    uint32_t count;
+    uint32_t size;
+    uint64_t now; /* monotonic ns when dumped, or when a capture began */
+};
+
+/* a $TFWM_CAPTURE file: a trace_header with CAPTURE_MAGIC and count 0,
+ * then capture_entry after capture_entry, each followed by size bytes.
+ * a restart appends another header and session. */
+enum {
+    CAPTURE_TRACE,   /* a trace_record, for tools/tfwm-trace */
+    CAPTURE_SESSION, /* a capture_session */
+    CAPTURE_MANAGE,  /* setup manages window, already mapped */
+    CAPTURE_READY,   /* setup is done */
+    CAPTURE_EVENT,   /* the event loop took this event off the queue */
+    CAPTURE_DRAINED, /* and ran out of them */
+    CAPTURE_ASK,     /* a read was sent: request, seq, window, atom */
+    CAPTURE_ANSWER,  /* what came back to seq, or to request on window */
+};
+
+/* the answers that don't come to a read, by what asked for them */
+enum {
+    CAPTURE_WAIT = 0xf0, /* an event a drag waited for */
+    CAPTURE_NEW_ID,      /* an id for a window */
+    CAPTURE_KEYSYM,      /* the keysym for keycode window */
+    CAPTURE_KEYCODES,    /* the keycodes for keysym window, 0 ended */
+};
+
+/* an answer names the read it came back to by seq, with request 0, or,
+ * when nothing was sent for it, by request and window */
+struct capture_entry {
+    uint32_t size;   /* of what follows */
+    uint32_t window; /* or the keycode or keysym looked up */
+    uint32_t atom;
+    uint16_t seq;
+    uint8_t kind;
+    uint8_t request; /* major opcode, or CAPTURE_WAIT and on */
+};
+
+/* what setup found, for a replay to start from. followed by natoms ewmh
+ * atoms, those of xcb_ewmh_connection_t from _NET_SUPPORTED on. */
+struct capture_session {
+    uint32_t root;
+    uint16_t width, height;
+    uint32_t numlockmask;
+    uint32_t focus_pixel, unfocus_pixel;
+    uint32_t wm_delete_window, wm_take_focus, wm_protocols;
+    uint32_t net_startup_id, wm_window_role;
+    uint32_t natoms;
+};
+
+void trace_setup(void);
+void trace_event(const xcb_generic_event_t *ev, uint64_t start,
+                 uint64_t duration);
+void trace_section(int section, xcb_window_t win, uint64_t start,
+                   uint64_t duration);
+void trace_dump(void);
+void trace_session(void);
+void trace_capture(uint8_t kind, xcb_window_t win, const void *data,
+                   uint32_t size);
+void trace_ask(uint8_t request, unsigned int seq, xcb_window_t win,
+               xcb_atom_t atom);
+void trace_answer(uint8_t request, unsigned int seq, uint32_t key,
+                  const void *data, uint32_t size);
+void trace_teardown(void);
+
+#endif
@@ -0,0 +1,202 @@
+/* See LICENSE file for copyright and license details. */
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <xcb/xcbext.h>
+#include "main.h"
+#include "stats.h"
+#include "trace.h"
+#include "watchdog.h"
+#include "log.h"
+
+#define CHECK_MS 250
+#define STALL_NS 1000000000ull      /* event loop away from its wait */
+#define PROBE_EVERY_NS 1000000000ull /* X server round trip */
+#define PROBE_SLOW_NS 250000000ull
+
+/* set by the event loop when it leaves its wait, cleared when it's back */
+static uint64_t busy_since;
+
+/* the thread parks while the event loop is idle, so an idle session
+ * never wakes it; the loop's next event wakes it again */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER;
+static bool parked;
+static uint32_t activity; /* times the loop has left its wait */
+
+/* written by the watchdog thread only */
+static struct {
+    uint32_t stalls;
+    uint64_t longest_stall;
+    uint32_t probes;
+    uint32_t slow_probes;
+    uint64_t probe_total;
+    uint64_t probe_last;
+    uint64_t probe_max;
+} w;
+
+void watchdog_busy(void) {
+    __atomic_store_n(&busy_since, stats_now(), __ATOMIC_RELAXED);
+    __atomic_add_fetch(&activity, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&parked, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&lock);
+        parked = false;
+        pthread_cond_signal(&wake);
+        pthread_mutex_unlock(&lock);
+    }
+}
+
+void watchdog_idle(void) {
+    __atomic_store_n(&busy_since, 0, __ATOMIC_RELAXED);
+}
+
+static void check_stall(uint64_t now, bool *stalled, uint64_t *stall) {
+    const uint64_t since = __atomic_load_n(&busy_since, __ATOMIC_RELAXED);
+    unsigned int wait;
+
+    if (since && now - since > STALL_NS) {
+        *stall = now - since;
+        if (*stall > w.longest_stall)
+            w.longest_stall = *stall;
+        if (*stalled)
+            return;
+        *stalled = true;
+        w.stalls++;
+        const int section = stats_active(&wait);
+        warn("watchdog: event loop stuck for %llu ms in %s, last reply "
+             "waited on: request %u\n",
+             (unsigned long long)(*stall / 1000000),
+             section >= 0 ? stats_section_name(section) : "(none)", wait);
+        trace_dump();
+    } else if (*stalled) {
+        *stalled = false;
+        warn("watchdog: event loop back after at least %llu ms\n",
+             (unsigned long long)(*stall / 1000000));
+    }
+}
+
+/* sleep until the event loop leaves its wait, if it hasn't since seen
+ * and isn't away from it now */
+static void park(uint32_t *seen) {
+    pthread_mutex_lock(&lock);
+    __atomic_store_n(&parked, true, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&busy_since, __ATOMIC_RELAXED) ||
+        __atomic_load_n(&activity, __ATOMIC_SEQ_CST) != *seen)
+        parked = false;
+    while (parked)
+        pthread_cond_wait(&wake, &lock);
+    pthread_mutex_unlock(&lock);
+    *seen = __atomic_load_n(&activity, __ATOMIC_SEQ_CST);
+}
+
+/* times GetInputFocus on a connection of its own, so the probe measures
+ * the server whatever the event loop is doing, and never blocks. probes
+ * and stall checks only run while the loop is active. */
+static void *watchdog_main(void *arg) {
+    xcb_connection_t *probe = arg;
+    xcb_get_input_focus_cookie_t cookie;
+    bool inflight = false, slow = false, stalled = false;
+    uint64_t sent = 0, next = 0, stall = 0;
+    uint32_t seen = 0;
+    struct pollfd pfd = {xcb_get_file_descriptor(probe), POLLIN, 0};
+
+    for (;;) {
+        uint64_t now;
+
+        if (!inflight)
+            park(&seen);
+        now = stats_now();
+
+        if (!inflight && now >= next) {
+            cookie = xcb_get_input_focus(probe);
+            xcb_flush(probe);
+            sent = now;
+            inflight = true;
+        }
+
+        poll(&pfd, 1, CHECK_MS);
+        now = stats_now();
+
+        if (inflight) {
+            void *reply = NULL;
+            xcb_generic_error_t *e = NULL;
+            if (xcb_poll_for_reply(probe, cookie.sequence, &reply, &e)) {
+                const uint64_t ns = now - sent;
+                free(reply);
+                free(e);
+                inflight = false;
+                next = sent + PROBE_EVERY_NS;
+                w.probes++;
+                w.probe_total += ns;
+                w.probe_last = ns;
+                if (ns > w.probe_max)
+                    w.probe_max = ns;
+                if (slow)
+                    warn("watchdog: X server answered after %llu ms\n",
+                         (unsigned long long)(ns / 1000000));
+                slow = false;
+            } else if (!slow && now - sent > PROBE_SLOW_NS) {
+                slow = true;
+                w.slow_probes++;
+                warn("watchdog: X server hasn't answered in %llu ms\n",
+                     (unsigned long long)((now - sent) / 1000000));
+            }
+            if (xcb_connection_has_error(probe))
+                return NULL;
+        }
+
+        check_stall(now, &stalled, &stall);
+    }
+    return NULL;
+}
+
+/* start after the launch helper has forked, so it never has a thread */
+void watchdog_setup(void) {
+    xcb_connection_t *probe = xcb_connect(NULL, NULL);
+    pthread_attr_t attr;
+    pthread_t thread;
+    sigset_t all, old;
+
+    if (xcb_connection_has_error(probe)) {
+        warn("watchdog: can't open a probe connection\n");
+        xcb_disconnect(probe);
+        return;
+    }
+    fcntl(xcb_get_file_descriptor(probe), F_SETFD, FD_CLOEXEC);
+
+    /* the thread inherits the mask, so every signal goes to the event
+     * loop, whose poll() it interrupts */
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&thread, &attr, watchdog_main, probe) != 0) {
+        warn("watchdog: can't start thread\n");
+        xcb_disconnect(probe);
+    }
+    pthread_attr_destroy(&attr);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+}
+
+void watchdog_dump(FILE *out, FILE *tsv) {
+    const uint32_t probes = w.probes;
+    const unsigned long long mean = probes ? w.probe_total / probes / 1000 : 0;
+
+    fprintf(out,
+            "watchdog: %u stalls, longest %llu ms; X round trip: %u probes, "
+            "last %llu us, mean %llu us, max %llu us, %u slow\n",
+            w.stalls, (unsigned long long)(w.longest_stall / 1000000), probes,
+            (unsigned long long)(w.probe_last / 1000), mean,
+            (unsigned long long)(w.probe_max / 1000), w.slow_probes);
+    if (tsv)
+        fprintf(tsv,
+                "stalls\tlongest_stall_ms\tprobes\tprobe_last_us\t"
+                "probe_mean_us\tprobe_max_us\tslow_probes\n"
+                "%u\t%llu\t%u\t%llu\t%llu\t%llu\t%u\n",
+                w.stalls, (unsigned long long)(w.longest_stall / 1000000),
+                probes, (unsigned long long)(w.probe_last / 1000), mean,
+                (unsigned long long)(w.probe_max / 1000), w.slow_probes);
+}
@@ -0,0 +1,12 @@
+/* See LICENSE file for copyright and license details. */
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include <stdio.h>
+
+void watchdog_setup(void);
+void watchdog_busy(void);
+void watchdog_idle(void);
+void watchdog_dump(FILE *out, FILE *tsv);
+
+#endif
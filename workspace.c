@@ -2,20 +2,28 @@
 #include "main.h"
 #include "list.h"
 #include "client.h"
+#include "ewmh.h"
+#include "config.h"
+#include "geom.h"
 #include "workspace.h"
+#include "stats.h"
 #include "log.h"
 
 static unsigned int prevws = 0;
 unsigned int selws = 0;
 
 static void gotows(unsigned int i) {
+    StatsMark mark;
+
     if (selws == i)
         return;
-    xcb_ewmh_set_current_desktop(ewmh, scrno, i);
+    stats_start(&mark, STAT_WORKSPACE);
+    ewmh_set_current_desktop(i);
     prevws = selws;
     selws = i;
     focus(NULL);
-    showhide(stack);
+    showhide(prevws, selws);
+    stats_record(&mark);
 }
 
 void selectrws(const Arg *arg) {
@@ -23,9 +31,9 @@ void selectrws(const Arg *arg) {
     if (arg->i == LastWorkspace)
         i = prevws;
     else if (arg->i == PrevWorkspace)
-        i = selws == 0 ? 9 : selws - 1;
+        i = selws == 0 ? WORKSPACES - 1 : selws - 1;
     else if (arg->i == NextWorkspace)
-        i = selws == 9 ? 0 : selws + 1;
+        i = selws == WORKSPACES - 1 ? 0 : selws + 1;
     else
         return;
     gotows(i);
@@ -39,6 +47,7 @@ void sendtows(const Arg *arg) {
     if (arg->i == selws)
         return;
     sel->ws = arg->i;
-    showhide(stack);
+    geom_update(sel);
+    movewin(sel->frame, HIDDEN_X(sel), sel->geom.y);
     focus(NULL);
 }
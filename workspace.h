@@ -2,6 +2,9 @@
 #ifndef WORKSPACE_H
 #define WORKSPACE_H
 
+/* bound to the number keys, 1 to 0 */
+#define WORKSPACES 10
+
 void selectrws(const Arg *arg);
 void selectws(const Arg *arg);
 void sendtows(const Arg *arg);
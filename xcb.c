@@ -2,32 +2,13 @@
 #include <stdio.h>
 #include <string.h>
 #include "main.h"
+#include "backend.h"
 #include "xcb.h"
 #include "config.h"
 #include "keys.h"
+#include "stats.h"
 #include "log.h"
 
-#ifdef DEBUG
-char *get_atom_name(xcb_atom_t atom) {
-    xcb_get_atom_name_reply_t *r =
-        xcb_get_atom_name_reply(conn, xcb_get_atom_name(conn, atom), NULL);
-    if (!r)
-        return NULL;
-
-    char *name;
-    int len = xcb_get_atom_name_name_length(r);
-    if (len) {
-        if (!(name = malloc(len + 1)))
-            err("can't allocate memory.");
-        memcpy(name, xcb_get_atom_name_name(r), len);
-        name[len] = '\0';
-    }
-
-    FREE(r);
-    return name;
-}
-#endif
-
 bool connection_has_error(void) {
     int err = 0;
 
@@ -63,8 +44,10 @@ bool connection_has_error(void) {
 }
 
 void getatom(xcb_atom_t *atom, const char *name) {
-    xcb_intern_atom_reply_t *r = xcb_intern_atom_reply(
-        conn, xcb_intern_atom(conn, 0, strlen(name), name), NULL);
+    xcb_intern_atom_cookie_t cookie =
+        xcb_intern_atom(conn, 0, strlen(name), name);
+    stats_wait(cookie.sequence);
+    xcb_intern_atom_reply_t *r = xcb_intern_atom_reply(conn, cookie, NULL);
 
     if (r) {
         *atom = r->atom;
@@ -86,15 +69,19 @@ uint32_t getcolor(const char *color) {
         r = (r << 8) | r;
         g = (g << 8) | g;
         b = (b << 8) | b;
-        xcb_alloc_color_reply_t *cr = xcb_alloc_color_reply(
-            conn, xcb_alloc_color(conn, map, r, g, b), NULL);
+        xcb_alloc_color_cookie_t cc = xcb_alloc_color(conn, map, r, g, b);
+        stats_wait(cc.sequence);
+        xcb_alloc_color_reply_t *cr = xcb_alloc_color_reply(conn, cc, NULL);
         if (!cr)
             err("can't alloc color.");
         pixel = cr->pixel;
         FREE(cr);
     } else {
-        xcb_alloc_named_color_reply_t *ncr = xcb_alloc_named_color_reply(
-            conn, xcb_alloc_named_color(conn, map, strlen(color), color), NULL);
+        xcb_alloc_named_color_cookie_t ncc =
+            xcb_alloc_named_color(conn, map, strlen(color), color);
+        stats_wait(ncc.sequence);
+        xcb_alloc_named_color_reply_t *ncr =
+            xcb_alloc_named_color_reply(conn, ncc, NULL);
         if (!ncr)
             err("can't alloc named color.");
         pixel = ncr->pixel;
@@ -109,16 +96,12 @@ void grabbuttons(void) {
 
     const uint8_t buttons[] = {XCB_BUTTON_INDEX_1, XCB_BUTTON_INDEX_3};
 
-    xcb_ungrab_button(conn, XCB_BUTTON_INDEX_ANY, screen->root,
-                      XCB_MOD_MASK_ANY);
+    backend_ungrab_buttons();
 
     for (int i = 0; i < LENGTH(buttons); i++) {
         for (int j = 0; j < LENGTH(modifiers); j++) {
-            xcb_grab_button(conn, 0, screen->root, XCB_EVENT_MASK_BUTTON_PRESS,
-                            XCB_GRAB_MODE_SYNC, XCB_GRAB_MODE_ASYNC,
-                            XCB_WINDOW_NONE, XCB_CURSOR_NONE, buttons[i],
-                            XCB_MOD_MASK_ANY);
-                            /* XCB_MOD_MASK_1 | modifiers[j]); */
+            backend_grab_button(XCB_MOD_MASK_ANY, buttons[i]);
+            /* backend_grab_button(XCB_MOD_MASK_1 | modifiers[j], ...); */
         }
     }
 }
@@ -150,5 +133,5 @@ void warp_pointer(Client *c) {
         warn("warp_pointer: bad setting: %d\n", cursor_position);
     }
 
-    xcb_warp_pointer(conn, XCB_NONE, c->win, 0, 0, 0, 0, x, y);
+    backend_warp(c->win, x, y);
 }